@@ -0,0 +1,199 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "imagesettest.h"
+
+#include <utility>
+
+#include <QFontDatabase>
+#include <QGuiApplication>
+#include <QPalette>
+
+#include "ksvg/private/imageset_p.h"
+
+using KSvg::ImageSetPrivate;
+using KSvg::Svg;
+
+// What ImageSetPrivate::processStyleSheet() used to do, one replace per placeholder
+static QString
+replacedStyleSheet(const QString &css, Svg::Status status, const QPalette &palette, const QColor &positive, const QColor &neutral, const QColor &negative)
+{
+    QString stylesheet(css);
+
+    QPalette::ColorGroup group;
+    switch (status) {
+    case Svg::Status::Inactive:
+        group = QPalette::Disabled;
+        break;
+    case Svg::Status::Selected:
+        group = QPalette::Active;
+        break;
+    default:
+        group = QPalette::Normal;
+    }
+
+    QHash<QString, QString> elements;
+    if (status == Svg::Status::Selected) {
+        elements[QStringLiteral("%textcolor")] = palette.color(group, QPalette::HighlightedText).name();
+        elements[QStringLiteral("%backgroundcolor")] = palette.color(group, QPalette::Highlight).name();
+    } else {
+        elements[QStringLiteral("%textcolor")] = palette.color(group, QPalette::WindowText).name();
+        elements[QStringLiteral("%backgroundcolor")] = palette.color(group, QPalette::Window).name();
+    }
+
+    elements[QStringLiteral("%highlightcolor")] = palette.color(group, QPalette::Highlight).name();
+    elements[QStringLiteral("%highlightedtextcolor")] = palette.color(group, QPalette::HighlightedText).name();
+    elements[QStringLiteral("%visitedlink")] = palette.color(group, QPalette::LinkVisited).name();
+    elements[QStringLiteral("%activatedlink")] = palette.color(group, QPalette::Highlight).name();
+    elements[QStringLiteral("%hoveredlink")] = palette.color(group, QPalette::Highlight).name();
+    elements[QStringLiteral("%link")] = palette.color(group, QPalette::Link).name();
+    elements[QStringLiteral("%positivetextcolor")] = positive.name();
+    elements[QStringLiteral("%neutraltextcolor")] = neutral.name();
+    elements[QStringLiteral("%negativetextcolor")] = negative.name();
+
+    QFont font = QGuiApplication::font();
+    elements[QStringLiteral("%fontsize")] = QStringLiteral("%1pt").arg(font.pointSize());
+    QString family{font.family()};
+    family.truncate(family.indexOf(QLatin1Char('[')));
+    elements[QStringLiteral("%fontfamily")] = family;
+    elements[QStringLiteral("%smallfontsize")] = QStringLiteral("%1pt").arg(QFontDatabase::systemFont(QFontDatabase::SmallestReadableFont).pointSize());
+
+    for (auto it = elements.constBegin(); it != elements.constEnd(); ++it) {
+        stylesheet.replace(it.key(), it.value());
+    }
+    return stylesheet;
+}
+
+void ImageSetTest::rawPixmap_data()
+{
+    QTest::addColumn<QImage>("image");
+
+    QImage gradient(37, 11, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < gradient.height(); ++y) {
+        for (int x = 0; x < gradient.width(); ++x) {
+            gradient.setPixel(x, y, qPremultiply(qRgba(x * 7, y * 23, 128, (x + y) * 8)));
+        }
+    }
+    QTest::newRow("premultiplied") << gradient;
+
+    QImage scaled = gradient;
+    scaled.setDevicePixelRatio(2);
+    QTest::newRow("device pixel ratio") << scaled;
+
+    QTest::newRow("not premultiplied") << gradient.convertToFormat(QImage::Format_ARGB32);
+    QTest::newRow("no alpha") << gradient.convertToFormat(QImage::Format_RGB32);
+    QTest::newRow("single pixel") << gradient.copy(3, 3, 1, 1);
+}
+
+void ImageSetTest::rawPixmap()
+{
+    QFETCH(QImage, image);
+
+    const QByteArray data = ImageSetPrivate::encodeRawPixmap(image);
+    QVERIFY(!data.isEmpty());
+
+    const QImage decoded = ImageSetPrivate::decodeRawPixmap(data);
+    QCOMPARE(decoded.format(), QImage::Format_ARGB32_Premultiplied);
+    QCOMPARE(decoded.devicePixelRatio(), image.devicePixelRatio());
+    QCOMPARE(decoded, image.convertToFormat(QImage::Format_ARGB32_Premultiplied));
+
+    // Still valid once the data it was decoded from is gone
+    QImage copy;
+    {
+        QByteArray temporary = data;
+        temporary.detach();
+        copy = ImageSetPrivate::decodeRawPixmap(temporary);
+    }
+    QCOMPARE(copy, decoded);
+}
+
+void ImageSetTest::invalidRawPixmap_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QImage image(8, 4, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    const QByteArray data = ImageSetPrivate::encodeRawPixmap(image);
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("header only") << data.left(32);
+    QTest::newRow("truncated") << data.chopped(1);
+    QTest::newRow("too long") << data + QByteArray(4, '\0');
+
+    QByteArray magic = data;
+    magic[0] = 'X';
+    QTest::newRow("magic") << magic;
+
+    // Written by a former compressed mode
+    QByteArray reserved = data;
+    reserved[4] = 1;
+    QTest::newRow("reserved") << reserved;
+
+    QTest::newRow("png") << QByteArray("\x89PNG\r\n\x1a\n", 8) + QByteArray(64, '\0');
+}
+
+void ImageSetTest::invalidRawPixmap()
+{
+    QFETCH(QByteArray, data);
+    QVERIFY(ImageSetPrivate::decodeRawPixmap(data).isNull());
+}
+
+void ImageSetTest::styleSheetTemplate_data()
+{
+    QTest::addColumn<QString>("css");
+    QTest::addColumn<int>("status");
+
+    const QString colorScheme = QStringLiteral(
+        ".ColorScheme-Text{color:%textcolor;}"
+        ".ColorScheme-Background{color:%backgroundcolor;}"
+        ".ColorScheme-Highlight{color:%highlightcolor;}"
+        ".ColorScheme-HighlightedText{color:%highlightedtextcolor;}"
+        ".ColorScheme-PositiveText{color:%positivetextcolor;}"
+        ".ColorScheme-NeutralText{color:%neutraltextcolor;}"
+        ".ColorScheme-NegativeText{color:%negativetextcolor;}");
+    const QString links = QStringLiteral("a{color:%link;} a:visited{color:%visitedlink;} a:hover{color:%hoveredlink;} a:active{color:%activatedlink;}");
+    const QString fonts = QStringLiteral("text{font-family:%fontfamily;font-size:%fontsize;} small{font-size:%smallfontsize;}");
+
+    const std::pair<const char *, Svg::Status> statuses[] = {
+        {"normal", Svg::Status::Normal},
+        {"selected", Svg::Status::Selected},
+        {"inactive", Svg::Status::Inactive},
+    };
+    for (const auto &[name, status] : statuses) {
+        QTest::addRow("color scheme, %s", name) << colorScheme << int(status);
+        QTest::addRow("links, %s", name) << links << int(status);
+        QTest::addRow("fonts, %s", name) << fonts << int(status);
+    }
+    QTest::newRow("empty") << QString() << int(Svg::Status::Normal);
+    QTest::newRow("no placeholder") << QStringLiteral("rect{fill:#ff0000;}") << int(Svg::Status::Normal);
+    QTest::newRow("unknown placeholders") << QStringLiteral("a{width:100%;color:%unknown;} %") << int(Svg::Status::Normal);
+    QTest::newRow("adjacent") << QStringLiteral("%textcolor%backgroundcolor%%link%linkvisited") << int(Svg::Status::Normal);
+}
+
+void ImageSetTest::styleSheetTemplate()
+{
+    QFETCH(QString, css);
+    QFETCH(int, status);
+
+    QPalette palette;
+    palette.setColor(QPalette::Normal, QPalette::WindowText, QColor(0x232629));
+    palette.setColor(QPalette::Normal, QPalette::Window, QColor(0xeff0f1));
+    palette.setColor(QPalette::Active, QPalette::Highlight, QColor(0x3daee9));
+    palette.setColor(QPalette::Active, QPalette::HighlightedText, QColor(0xfcfcfc));
+    palette.setColor(QPalette::Disabled, QPalette::WindowText, QColor(0xa0a1a3));
+    palette.setColor(QPalette::Normal, QPalette::Link, QColor(0x2980b9));
+    palette.setColor(QPalette::Normal, QPalette::LinkVisited, QColor(0x7f8c8d));
+    const QColor positive(0x27ae60);
+    const QColor neutral(0xf67400);
+    const QColor negative(0xda4453);
+
+    const ImageSetPrivate::StyleSheetTemplate styleSheet = ImageSetPrivate::compileStyleSheet(css);
+    QCOMPARE(styleSheet.literals.size(), styleSheet.placeholders.size() + 1);
+    QCOMPARE(ImageSetPrivate::fillStyleSheet(styleSheet, Svg::Status(status), palette, positive, neutral, negative),
+             replacedStyleSheet(css, Svg::Status(status), palette, positive, neutral, negative));
+}
+
+QTEST_MAIN(ImageSetTest)
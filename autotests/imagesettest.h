@@ -0,0 +1,24 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#ifndef IMAGESETTEST_H
+#define IMAGESETTEST_H
+
+#include <QTest>
+
+class ImageSetTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void rawPixmap_data();
+    void rawPixmap();
+    void invalidRawPixmap_data();
+    void invalidRawPixmap();
+    void styleSheetTemplate_data();
+    void styleSheetTemplate();
+};
+
+#endif
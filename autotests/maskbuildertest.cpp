@@ -0,0 +1,108 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "maskbuildertest.h"
+
+#include <algorithm>
+
+#include <QBitmap>
+#include <QPixmap>
+#include <QStandardPaths>
+
+#include "ksvg/framesvg.h"
+#include "ksvg/private/maskbuilder_p.h"
+
+// What FrameSvg::mask() used to do
+static QRegion referenceRegion(const QImage &image)
+{
+    return QRegion(QBitmap(QPixmap::fromImage(image).mask()));
+}
+
+void MaskBuilderTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void MaskBuilderTest::regionFromAlpha_data()
+{
+    QTest::addColumn<QImage>("image");
+
+    // Widths around the 4 pixels handled at once
+    for (int width : {1, 2, 3, 5, 7, 13, 31}) {
+        QImage image(width, 9, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        for (int y = 0; y < image.height(); ++y) {
+            for (int x = 0; x < width; ++x) {
+                if ((x + y) % 3 != 0) {
+                    image.setPixel(x, y, qRgba(0, 0, 0, 255));
+                }
+            }
+        }
+        QTest::addRow("odd width %d", width) << image;
+    }
+
+    QImage rows(17, 12, QImage::Format_ARGB32_Premultiplied);
+    rows.fill(Qt::black);
+    for (int y : {0, 1, 5, 11}) {
+        for (int x = 0; x < rows.width(); ++x) {
+            rows.setPixel(x, y, qRgba(0, 0, 0, 0));
+        }
+    }
+    QTest::addRow("transparent rows") << rows;
+
+    QImage empty(10, 10, QImage::Format_ARGB32_Premultiplied);
+    empty.fill(Qt::transparent);
+    QTest::addRow("fully transparent") << empty;
+
+    // An opaque center fading out through the threshold in its borders, like the shadows of frames
+    QImage fading(41, 23, QImage::Format_ARGB32_Premultiplied);
+    fading.fill(Qt::transparent);
+    for (int y = 0; y < fading.height(); ++y) {
+        for (int x = 0; x < fading.width(); ++x) {
+            const int distance = std::min({x, y, fading.width() - 1 - x, fading.height() - 1 - y});
+            const int alpha = std::min(255, 120 + distance * 4 + (x % 2));
+            fading.setPixel(x, y, qRgba(0, 0, 0, alpha));
+        }
+    }
+    QTest::addRow("partly transparent borders") << fading;
+    QTest::addRow("partly transparent borders, not premultiplied") << fading.convertToFormat(QImage::Format_ARGB32);
+}
+
+void MaskBuilderTest::regionFromAlpha()
+{
+    QFETCH(QImage, image);
+
+    QCOMPARE(KSvg::MaskBuilder::regionFromAlpha(image), referenceRegion(image));
+}
+
+void MaskBuilderTest::frameMask_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("borders");
+
+    for (const QSize &size : {QSize(100, 100), QSize(101, 37), QSize(333, 17), QSize(57, 203)}) {
+        QTest::addRow("%dx%d", size.width(), size.height()) << size << int(KSvg::FrameSvg::AllBorders);
+        QTest::addRow("%dx%d top left", size.width(), size.height()) << size << int(KSvg::FrameSvg::TopBorder | KSvg::FrameSvg::LeftBorder);
+    }
+}
+
+void MaskBuilderTest::frameMask()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, borders);
+
+    KSvg::FrameSvg frameSvg;
+    frameSvg.setImagePath(QFINDTESTDATA("data/background.svgz"));
+    QVERIFY(frameSvg.isValid());
+    frameSvg.setEnabledBorders(KSvg::FrameSvg::EnabledBorders(borders));
+    frameSvg.resizeFrame(size);
+
+    const QPixmap alphaMask = frameSvg.alphaMask();
+    QVERIFY(!alphaMask.isNull());
+    QCOMPARE(frameSvg.mask(), QRegion(QBitmap(alphaMask.mask())));
+}
+
+QTEST_MAIN(MaskBuilderTest)
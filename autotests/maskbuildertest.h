@@ -0,0 +1,25 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#ifndef MASKBUILDERTEST_H
+#define MASKBUILDERTEST_H
+
+#include <QTest>
+
+class MaskBuilderTest : public QObject
+{
+    Q_OBJECT
+
+public Q_SLOTS:
+    void initTestCase();
+
+private Q_SLOTS:
+    void regionFromAlpha_data();
+    void regionFromAlpha();
+    void frameMask_data();
+    void frameMask();
+};
+
+#endif
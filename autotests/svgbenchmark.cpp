@@ -0,0 +1,222 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "svgbenchmark.h"
+
+#include <QFileInfo>
+#include <QPainter>
+#include <QStandardPaths>
+
+#include <KCompressionDevice>
+
+#include "ksvg/private/imageset_p.h"
+#include "ksvg/private/pixmapcachewriter_p.h"
+#include "ksvg/private/svg_p.h"
+
+void SvgBenchmark::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    m_cacheDir = QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation));
+    m_cacheDir.removeRecursively();
+
+    m_svgPath = QFINDTESTDATA("data/background.svgz");
+    QVERIFY(!m_svgPath.isEmpty());
+
+    KCompressionDevice file(m_svgPath, KCompressionDevice::GZip);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    m_contents = file.readAll();
+    QVERIFY(!m_contents.isEmpty());
+
+    m_svg = new KSvg::Svg;
+    m_svg->setImagePath(m_svgPath);
+    QVERIFY(m_svg->isValid());
+
+    m_frameSvg = new KSvg::FrameSvg;
+    m_frameSvg->setImagePath(m_svgPath);
+    QVERIFY(m_frameSvg->isValid());
+
+    m_testImageSet = new KSvg::ImageSet(this);
+    m_testImageSet->setBasePath(QFINDTESTDATA("data/plasma/desktoptheme/"));
+    m_testImageSet->setImageSetName(QStringLiteral("testtheme"));
+}
+
+void SvgBenchmark::cleanupTestCase()
+{
+    delete m_svg;
+    delete m_frameSvg;
+
+    m_cacheDir.removeRecursively();
+}
+
+void SvgBenchmark::pixmapCold()
+{
+    m_svg->setUsingRenderingCache(false);
+    m_svg->resize(QSize(256, 256));
+
+    QBENCHMARK {
+        const QPixmap pixmap = m_svg->pixmap(QStringLiteral("center"));
+        QVERIFY(!pixmap.isNull());
+    }
+
+    m_svg->setUsingRenderingCache(true);
+}
+
+void SvgBenchmark::pixmapWarm()
+{
+    m_svg->resize(QSize(256, 256));
+    QVERIFY(!m_svg->pixmap(QStringLiteral("center")).isNull());
+
+    QBENCHMARK {
+        const QPixmap pixmap = m_svg->pixmap(QStringLiteral("center"));
+        QVERIFY(!pixmap.isNull());
+    }
+}
+
+void SvgBenchmark::elementRect()
+{
+    m_svg->resize();
+    QVERIFY(m_svg->elementRect(QStringLiteral("topleft")).isValid());
+
+    QBENCHMARK {
+        m_svg->elementRect(QStringLiteral("topleft"));
+        m_svg->elementRect(QStringLiteral("center"));
+        m_svg->elementRect(QStringLiteral("hint-top-margin"));
+        m_svg->elementRect(QStringLiteral("not-existing"));
+    }
+}
+
+void SvgBenchmark::themedImagePath()
+{
+    QBENCHMARK {
+        m_testImageSet->imagePath(QStringLiteral("element"));
+        m_testImageSet->imagePath(QStringLiteral("opaque/element"));
+    }
+}
+
+void SvgBenchmark::framePixmap_data()
+{
+    QTest::addColumn<QSize>("size");
+
+    for (int size : {64, 128, 256, 512, 1024}) {
+        QTest::addRow("%dx%d", size, size) << QSize(size, size);
+        QTest::addRow("%dx%d", size * 2, size) << QSize(size * 2, size);
+    }
+}
+
+void SvgBenchmark::framePixmap()
+{
+    QFETCH(QSize, size);
+
+    // Measure the composition of the frame, not the lookup of the pixmap cache
+    m_frameSvg->setUsingRenderingCache(false);
+    m_frameSvg->resizeFrame(size);
+
+    QBENCHMARK {
+        m_frameSvg->clearCache();
+        const QPixmap pixmap = m_frameSvg->framePixmap();
+        QCOMPARE(pixmap.size(), size);
+    }
+
+    m_frameSvg->setUsingRenderingCache(true);
+}
+
+void SvgBenchmark::mask_data()
+{
+    framePixmap_data();
+}
+
+void SvgBenchmark::mask()
+{
+    QFETCH(QSize, size);
+
+    m_frameSvg->resizeFrame(size);
+    QVERIFY(!m_frameSvg->mask().isEmpty());
+
+    QBENCHMARK {
+        m_frameSvg->clearCache();
+        m_frameSvg->mask();
+    }
+}
+
+void SvgBenchmark::rendererLoad_data()
+{
+    QTest::addColumn<QByteArray>("contents");
+    QTest::addColumn<QString>("styleSheet");
+
+    // background.svgz has no color scheme, add one to go through the style sheet rewriting
+    QByteArray styledContents = m_contents;
+    const int svgStart = styledContents.indexOf("<svg");
+    const int svgEnd = styledContents.indexOf('>', svgStart);
+    QVERIFY(svgStart >= 0 && svgEnd > svgStart);
+    styledContents.insert(svgEnd + 1, "<style id=\"current-color-scheme\" type=\"text/css\">.ColorScheme-Text { color:#232629; }</style>");
+
+    QTest::addRow("plain") << m_contents << QString();
+    QTest::addRow("stylesheet") << styledContents << QStringLiteral(".ColorScheme-Text { color:#fcfcfc; }");
+}
+
+void SvgBenchmark::rendererLoad()
+{
+    QFETCH(QByteArray, contents);
+    QFETCH(QString, styleSheet);
+
+    QBENCHMARK {
+        QHash<QString, QRectF> interestingElements;
+        KSvg::SharedSvgRenderer renderer(contents, styleSheet, interestingElements);
+        QVERIFY(renderer.isValid());
+    }
+}
+
+void SvgBenchmark::rectsCacheLoad()
+{
+    const uint lastModified = QFileInfo(m_svgPath).lastModified().toSecsSinceEpoch();
+
+    // Populate the cache file, it gets written when the cache is destroyed
+    {
+        KSvg::SvgRectsCache cache;
+        for (uint id = 1; id <= 256; ++id) {
+            cache.insert(id, m_svgPath, QRectF(0, 0, id, id), lastModified);
+        }
+    }
+
+    QBENCHMARK {
+        KSvg::SvgRectsCache cache;
+        QVERIFY(cache.loadImageFromCache(m_svgPath, lastModified));
+        const QStringList keys = cache.cachedKeysForPath(m_svgPath);
+        QVERIFY(!keys.isEmpty());
+        QRectF rect;
+        QVERIFY(cache.findElementRect(keys.constFirst().toULongLong(), m_svgPath, rect));
+    }
+}
+
+void SvgBenchmark::imageSetFindInCache_data()
+{
+    QTest::addColumn<bool>("recent");
+
+    QTest::addRow("recent pixmaps") << true;
+    // Read from the shared memory and decoded every time
+    QTest::addRow("pixmap cache") << false;
+}
+
+void SvgBenchmark::imageSetFindInCache()
+{
+    QFETCH(bool, recent);
+
+    KSvg::ImageSetPrivate imageSet;
+    QPixmap pixmap(128, 128);
+    pixmap.fill(Qt::red);
+    imageSet.insertIntoCache(QStringLiteral("benchmark"), pixmap);
+    KSvg::PixmapCacheWriter::instance()->flush();
+
+    QBENCHMARK {
+        if (!recent) {
+            imageSet.recentPixmaps.clear();
+        }
+        QPixmap found;
+        QVERIFY(imageSet.findInCache(QStringLiteral("benchmark"), found, 1));
+    }
+}
+
+QTEST_MAIN(SvgBenchmark)
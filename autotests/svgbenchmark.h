@@ -0,0 +1,48 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#ifndef SVGBENCHMARK_H
+#define SVGBENCHMARK_H
+
+#include <QDir>
+#include <QTest>
+
+#include "ksvg/framesvg.h"
+#include "ksvg/imageset.h"
+#include "ksvg/svg.h"
+
+class SvgBenchmark : public QObject
+{
+    Q_OBJECT
+
+public Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+private Q_SLOTS:
+    void pixmapCold();
+    void pixmapWarm();
+    void elementRect();
+    void themedImagePath();
+    void framePixmap_data();
+    void framePixmap();
+    void mask_data();
+    void mask();
+    void rendererLoad_data();
+    void rendererLoad();
+    void rectsCacheLoad();
+    void imageSetFindInCache_data();
+    void imageSetFindInCache();
+
+private:
+    QString m_svgPath;
+    QByteArray m_contents;
+    KSvg::Svg *m_svg;
+    KSvg::FrameSvg *m_frameSvg;
+    KSvg::ImageSet *m_testImageSet;
+    QDir m_cacheDir;
+};
+
+#endif
@@ -0,0 +1,234 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "svgdocumenttest.h"
+
+#include <algorithm>
+
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QSvgRenderer>
+
+#include "ksvg/private/svg_p.h"
+
+using KSvg::SvgDocument;
+
+static QByteArray testDocument(const QString &id)
+{
+    return QStringLiteral(
+               "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"32\" height=\"32\">"
+               "<rect id=\"%1\" x=\"0\" y=\"0\" width=\"16\" height=\"16\"/>"
+               "<rect id=\"plain\" x=\"16\" y=\"16\" width=\"16\" height=\"16\"/>"
+               "</svg>")
+        .arg(id)
+        .toUtf8();
+}
+
+static QByteArray withDeclaration(const char *encoding, const QByteArray &document)
+{
+    return QByteArray("<?xml version=\"1.0\" encoding=\"") + encoding + "\"?>\n" + document;
+}
+
+void SvgDocumentTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+QString SvgDocumentTest::writeTestFile(const QString &name, const QByteArray &contents)
+{
+    QFile file(m_dir.filePath(name));
+    if (!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size()) {
+        return QString();
+    }
+    return file.fileName();
+}
+
+void SvgDocumentTest::index_data()
+{
+    QTest::addColumn<QByteArray>("contents");
+    QTest::addColumn<QStringList>("ids");
+    QTest::addColumn<QList<int>>("sizeHintLengths");
+    QTest::addColumn<QStringList>("styles");
+
+    QTest::newRow("quotes") << QByteArray("<svg><rect id=\"double\"/><rect id='single'/><g\n\tid = \"spaced\" ></g></svg>")
+                            << QStringList{QStringLiteral("double"), QStringLiteral("single"), QStringLiteral("spaced")} << QList<int>{0, 0, 0}
+                            << QStringList();
+    QTest::newRow("xml:id") << QByteArray("<svg><rect xml:id=\"fallback\"/><rect xml:id=\"ignored\" id=\"preferred\"/></svg>")
+                            << QStringList{QStringLiteral("fallback"), QStringLiteral("preferred")} << QList<int>{0, 0} << QStringList();
+    QTest::newRow("size hints") << QByteArray("<svg><rect id=\"16-16-center\"/><rect id=\"128-64-top\"/><rect id=\"16-center\"/>"
+                                              "<rect id=\"16-16-\"/><rect id=\"a-16-16-b\"/></svg>")
+                                << QStringList{QStringLiteral("16-16-center"),
+                                               QStringLiteral("128-64-top"),
+                                               QStringLiteral("16-center"),
+                                               QStringLiteral("16-16-"),
+                                               QStringLiteral("a-16-16-b")}
+                                << QList<int>{6, 7, 0, 0, 0} << QStringList();
+    QTest::newRow("comments and cdata") << QByteArray("<?xml version=\"1.0\"?><!DOCTYPE svg><svg><!-- <rect id=\"commented\"/> -->"
+                                                      "<script><![CDATA[ <rect id=\"cdata\"/> ]]></script><rect id=\"real\"/></svg>")
+                                        << QStringList{QStringLiteral("real")} << QList<int>{0} << QStringList();
+    QTest::newRow("style") << QByteArray("<svg><style id=\"current-color-scheme\" type=\"text/css\">.ColorScheme-Text{color:#000;}</style>"
+                                         "<style id=\"other\">rect{}</style><rect id=\"r\" class=\"ColorScheme-Text\"/></svg>")
+                           << QStringList{QStringLiteral("current-color-scheme"), QStringLiteral("other"), QStringLiteral("r")} << QList<int>{0, 0, 0}
+                           << QStringList{QStringLiteral(".ColorScheme-Text{color:#000;}")};
+    QTest::newRow("self closing style") << QByteArray("<svg><style id=\"current-color-scheme\"/><rect id=\"r\"/></svg>")
+                                        << QStringList{QStringLiteral("current-color-scheme"), QStringLiteral("r")} << QList<int>{0, 0}
+                                        << QStringList{QStringLiteral("/>")};
+    QTest::newRow("truncated") << QByteArray("<svg><rect id=\"complete\"/><rect id=\"cut") << QStringList{QStringLiteral("complete")} << QList<int>{0}
+                               << QStringList();
+}
+
+void SvgDocumentTest::index()
+{
+    QFETCH(QByteArray, contents);
+    QFETCH(QStringList, ids);
+    QFETCH(QList<int>, sizeHintLengths);
+    QFETCH(QStringList, styles);
+
+    const SvgDocument::Index index = SvgDocument::index(contents);
+
+    QStringList foundIds;
+    QList<int> foundSizeHintLengths;
+    for (const SvgDocument::ElementId &elementId : index.elementIds) {
+        foundIds << QString::fromUtf8(contents.mid(elementId.start, elementId.length));
+        foundSizeHintLengths << int(elementId.sizeHintLength);
+    }
+    QCOMPARE(foundIds, ids);
+    QCOMPARE(foundSizeHintLengths, sizeHintLengths);
+
+    QStringList foundStyles;
+    for (const SvgDocument::StyleRange &style : index.colorSchemeStyles) {
+        foundStyles << QString::fromUtf8(contents.mid(style.start, style.end - style.start));
+        QCOMPARE(style.selfClosing, foundStyles.constLast() == QLatin1String("/>"));
+    }
+    QCOMPARE(foundStyles, styles);
+}
+
+void SvgDocumentTest::applyStyleSheet_data()
+{
+    QTest::addColumn<QByteArray>("contents");
+    QTest::addColumn<QString>("styleSheet");
+    QTest::addColumn<QByteArray>("expected");
+
+    const QByteArray styled("<svg><style id=\"current-color-scheme\">.a{color:#000;}</style><rect/></svg>");
+    const QByteArray selfClosing("<svg><style id=\"current-color-scheme\" /><rect/></svg>");
+
+    QTest::newRow("replaced") << styled << QStringLiteral(".a{color:#fff;}")
+                              << QByteArray("<svg><style id=\"current-color-scheme\">.a{color:#fff;}</style><rect/></svg>");
+    QTest::newRow("self closing") << selfClosing << QStringLiteral(".a{color:#fff;}")
+                                  << QByteArray("<svg><style id=\"current-color-scheme\" >.a{color:#fff;}</style><rect/></svg>");
+    QTest::newRow("escaped") << styled << QStringLiteral("a>b{font-family:\"A&B\";}")
+                             << QByteArray("<svg><style id=\"current-color-scheme\">a&gt;b{font-family:\"A&amp;B\";}</style><rect/></svg>");
+    QTest::newRow("no style sheet") << styled << QString() << styled;
+    QTest::newRow("no style") << QByteArray("<svg><rect/></svg>") << QStringLiteral(".a{color:#fff;}") << QByteArray("<svg><rect/></svg>");
+    QTest::newRow("several styles") << styled + styled << QStringLiteral(".b{}")
+                                    << QByteArray("<svg><style id=\"current-color-scheme\">.b{}</style><rect/></svg>").repeated(2);
+}
+
+void SvgDocumentTest::applyStyleSheet()
+{
+    QFETCH(QByteArray, contents);
+    QFETCH(QString, styleSheet);
+    QFETCH(QByteArray, expected);
+
+    const SvgDocument::Index index = SvgDocument::index(contents);
+    QCOMPARE(SvgDocument::applyStyleSheet(contents, index.colorSchemeStyles, styleSheet), expected);
+}
+
+// The spliced document renders with the colors of the style sheet
+void SvgDocumentTest::styledRendering()
+{
+    const QByteArray contents(
+        "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"4\" height=\"4\">"
+        "<style id=\"current-color-scheme\" type=\"text/css\">.ColorScheme-Text{color:#000000;}</style>"
+        "<rect id=\"r\" class=\"ColorScheme-Text\" x=\"0\" y=\"0\" width=\"4\" height=\"4\" style=\"fill:currentColor\"/>"
+        "</svg>");
+
+    const QByteArray styled =
+        SvgDocument::applyStyleSheet(contents, SvgDocument::index(contents).colorSchemeStyles, QStringLiteral(".ColorScheme-Text{color:#ff0000;}"));
+    QSvgRenderer renderer(styled);
+    QVERIFY(renderer.isValid());
+
+    QImage image(4, 4, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    renderer.render(&painter);
+    painter.end();
+    QCOMPARE(image.pixel(2, 2), qRgb(255, 0, 0));
+}
+
+void SvgDocumentTest::elementIdFilter_data()
+{
+    QTest::addColumn<QByteArray>("contents");
+    QTest::addColumn<QStringList>("ids");
+    QTest::addColumn<bool>("filtered");
+
+    const QString accented = QStringLiteral("café");
+    const QByteArray utf8 = testDocument(accented);
+
+    QByteArray latin1 = utf8;
+    latin1.replace(accented.toUtf8(), accented.toLatin1());
+
+    const QString utf16String = QString::fromUtf8(withDeclaration("UTF-16", utf8));
+    QByteArray utf16("\xFF\xFE");
+    utf16.append(reinterpret_cast<const char *>(utf16String.utf16()), utf16String.size() * 2);
+
+    const QStringList ids = {accented, QStringLiteral("plain"), QStringLiteral("missing")};
+
+    QTest::newRow("utf-8") << utf8 << ids << true;
+    QTest::newRow("utf-8 declared") << withDeclaration("utf-8", utf8) << ids << true;
+    QTest::newRow("ascii declared") << withDeclaration("US-ASCII", testDocument(QStringLiteral("ascii"))) << QStringList{QStringLiteral("ascii"), QStringLiteral("plain")} << true;
+    QTest::newRow("utf-8 with bom") << QByteArray("\xEF\xBB\xBF") + utf8 << ids << false;
+    QTest::newRow("latin-1") << withDeclaration("ISO-8859-1", latin1) << ids << false;
+    QTest::newRow("utf-16") << utf16 << ids << false;
+    QTest::newRow("entity") << testDocument(QStringLiteral("caf&#233;")) << ids << false;
+
+    const QString background = QFINDTESTDATA("data/background.svgz");
+    QFile file(background);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray compressed = file.readAll();
+    // Read back through SvgDocument, which decompresses it
+    QTest::newRow("background") << compressed << QStringList{QStringLiteral("hint-top-margin"), QStringLiteral("not-there")} << true;
+}
+
+// No element of the document may be filtered out: the filter can only tell which ids certainly don't exist
+void SvgDocumentTest::elementIdFilter()
+{
+    QFETCH(QByteArray, contents);
+    QFETCH(QStringList, ids);
+    QFETCH(bool, filtered);
+
+    const QString path = writeTestFile(QString::fromLatin1(QTest::currentDataTag()).replace(QLatin1Char(' '), QLatin1Char('-')) + QStringLiteral(".svgz"), contents);
+    QVERIFY(!path.isEmpty());
+
+    const SvgDocument::Ptr document(new SvgDocument(path));
+    QSvgRenderer renderer(document->contents());
+    QVERIFY(renderer.isValid());
+
+    // Every id the scanner found, as the XML parser reads it
+    for (const SvgDocument::ElementId &elementId : document->elementIds()) {
+        const QString id = QString::fromUtf8(document->contents().mid(elementId.start, elementId.length));
+        if (renderer.elementExists(id)) {
+            ids.append(id);
+        }
+    }
+
+    QList<quint32> hashes;
+    QCOMPARE(document->elementIdHashes(hashes), filtered);
+    if (!filtered) {
+        return;
+    }
+
+    QVERIFY(std::is_sorted(hashes.cbegin(), hashes.cend()));
+    for (const QString &id : std::as_const(ids)) {
+        const bool mayExist = std::binary_search(hashes.cbegin(), hashes.cend(), quint32(KSvg::SvgAtom::intern(id)->hash));
+        if (renderer.elementExists(id)) {
+            QVERIFY2(mayExist, qPrintable(id));
+        }
+    }
+}
+
+QTEST_MAIN(SvgDocumentTest)
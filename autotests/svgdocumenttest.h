@@ -0,0 +1,34 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#ifndef SVGDOCUMENTTEST_H
+#define SVGDOCUMENTTEST_H
+
+#include <QTemporaryDir>
+#include <QTest>
+
+class SvgDocumentTest : public QObject
+{
+    Q_OBJECT
+
+public Q_SLOTS:
+    void initTestCase();
+
+private Q_SLOTS:
+    void index_data();
+    void index();
+    void applyStyleSheet_data();
+    void applyStyleSheet();
+    void styledRendering();
+    void elementIdFilter_data();
+    void elementIdFilter();
+
+private:
+    QString writeTestFile(const QString &name, const QByteArray &contents);
+
+    QTemporaryDir m_dir;
+};
+
+#endif
@@ -0,0 +1,275 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "svgrectscachefiletest.h"
+
+#include <cstddef>
+#include <memory>
+
+#include <QFile>
+#include <QStandardPaths>
+
+#include "ksvg/private/svg_p.h"
+#include "ksvg/private/svgrectscachefile_p.h"
+
+using KSvg::SvgRectsCacheFile;
+
+static const QString s_path = QStringLiteral("/usr/share/ksvg/test/background.svgz");
+static const QString s_otherPath = QStringLiteral("/usr/share/ksvg/test/background.svg");
+static const quint64 s_validKey = Q_UINT64_C(0x1234567800000010);
+static const quint64 s_invalidKey = Q_UINT64_C(0x8765432100000011);
+
+static QHash<QString, SvgRectsCacheFile::ImageData> testImages()
+{
+    SvgRectsCacheFile::ImageData image;
+    image.lastModified = 1700000000;
+    image.rects.insert(s_validKey, QRectF(1.5, 2, 30, 40.25));
+    image.rects.insert(s_invalidKey, QRectF());
+    // Same low 32 bits as s_validKey: only told apart by the fingerprint
+    image.rects.insert(Q_UINT64_C(0x0000000100000010), QRectF(0, 0, 8, 8));
+    image.naturalSizes.insert(1.0, QSizeF(100, 50));
+    image.naturalSizes.insert(2.0, QSizeF(200, 100));
+    image.sizeHints.insert(QStringLiteral("center"), {QSize(16, 16), QSize(32, 32)});
+    image.elementIds = {3, 7, 42};
+    image.hasElementIds = true;
+
+    SvgRectsCacheFile::ImageData other;
+    other.lastModified = 1600000000;
+    other.rects.insert(42, QRectF(0, 0, 1, 1));
+
+    return {{s_path, image}, {s_otherPath, other}};
+}
+
+void SvgRectsCacheFileTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_dir.isValid());
+}
+
+QString SvgRectsCacheFileTest::writeTestFile()
+{
+    const QString fileName = m_dir.filePath(QStringLiteral("rects.bin"));
+    if (!SvgRectsCacheFile::write(fileName, QStringLiteral("/icons/breeze"), testImages())) {
+        return QString();
+    }
+    return fileName;
+}
+
+void SvgRectsCacheFileTest::roundTrip()
+{
+    const QString fileName = writeTestFile();
+    QVERIFY(!fileName.isEmpty());
+
+    SvgRectsCacheFile file;
+    QVERIFY(file.open(fileName));
+    QCOMPARE(file.iconThemePath(), QStringLiteral("/icons/breeze"));
+    QVERIFY(!file.findImage(u"/usr/share/ksvg/test/missing.svg"));
+
+    const SvgRectsCacheFile::PathEntry *image = file.findImage(s_path);
+    QVERIFY(image);
+    QCOMPARE(image->lastModified, 1700000000u);
+
+    QRectF rect;
+    QVERIFY(file.findElementRect(image, s_validKey, rect));
+    QCOMPARE(rect, QRectF(1.5, 2, 30, 40.25));
+    QVERIFY(file.findElementRect(image, s_invalidKey, rect));
+    QVERIFY(rect.isNull());
+    QVERIFY(file.findElementRect(image, Q_UINT64_C(0x0000000100000010), rect));
+    QCOMPARE(rect, QRectF(0, 0, 8, 8));
+    QVERIFY(!file.findElementRect(image, Q_UINT64_C(0x0000000200000010), rect));
+
+    QCOMPARE(file.naturalSize(image, 2.0), QSizeF(200, 100));
+    QVERIFY(!file.naturalSize(image, 1.5).isValid());
+    QCOMPARE(file.sizeHintsForId(image, u"center"), QList<QSize>({QSize(16, 16), QSize(32, 32)}));
+    QVERIFY(file.sizeHintsForId(image, u"top").isEmpty());
+
+    QList<quint32> idHashes;
+    QVERIFY(file.elementIds(image, idHashes));
+    QCOMPARE(idHashes, QList<quint32>({3, 7, 42}));
+    QVERIFY(!file.elementIds(file.findImage(s_otherPath), idHashes));
+
+    // What sync() merges with its pending changes
+    const auto expected = testImages();
+    const auto images = file.images();
+    QCOMPARE(images.keys().size(), expected.size());
+    for (auto it = expected.constBegin(); it != expected.constEnd(); ++it) {
+        QVERIFY(images.contains(it.key()));
+        const SvgRectsCacheFile::ImageData &read = images[it.key()];
+        QCOMPARE(read.lastModified, it->lastModified);
+        QCOMPARE(read.rects, it->rects);
+        QCOMPARE(read.naturalSizes, it->naturalSizes);
+        QCOMPARE(read.sizeHints, it->sizeHints);
+        QCOMPARE(read.hasElementIds, it->hasElementIds);
+        QCOMPARE(read.elementIds, it->elementIds);
+    }
+}
+
+void SvgRectsCacheFileTest::pathHash()
+{
+    const QString fileName = writeTestFile();
+    QVERIFY(!fileName.isEmpty());
+
+    // The hashes are read back by other processes: they must never depend on the process or the Qt version
+    SvgRectsCacheFile file;
+    QVERIFY(file.open(fileName));
+    const SvgRectsCacheFile::PathEntry *image = file.findImage(s_path);
+    QVERIFY(image);
+    QCOMPARE(image->hash, 0x1b433f74u);
+}
+
+void SvgRectsCacheFileTest::truncated_data()
+{
+    QTest::addColumn<int>("removedBytes");
+
+    QTest::addRow("last byte") << 1;
+    QTest::addRow("path table") << int(sizeof(SvgRectsCacheFile::PathEntry));
+    QTest::addRow("header only") << -int(sizeof(SvgRectsCacheFile::Header));
+    QTest::addRow("partial header") << -int(sizeof(SvgRectsCacheFile::Header) - 1);
+}
+
+void SvgRectsCacheFileTest::truncated()
+{
+    QFETCH(int, removedBytes);
+
+    const QString fileName = writeTestFile();
+    QVERIFY(!fileName.isEmpty());
+
+    QFile file(fileName);
+    // Negative values are the size to keep
+    QVERIFY(file.resize(removedBytes > 0 ? file.size() - removedBytes : -removedBytes));
+
+    SvgRectsCacheFile cacheFile;
+    QVERIFY(!cacheFile.open(fileName));
+    QVERIFY(!cacheFile.findImage(s_path));
+}
+
+void SvgRectsCacheFileTest::corrupted_data()
+{
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<quint32>("value");
+
+    QTest::addRow("magic") << int(offsetof(SvgRectsCacheFile::Header, magic)) << quint32(0x21212121);
+    QTest::addRow("version") << int(offsetof(SvgRectsCacheFile::Header, version)) << quint32(SvgRectsCacheFile::s_version + 1);
+    QTest::addRow("byte order") << int(offsetof(SvgRectsCacheFile::Header, byteOrder)) << quint32(0x04030201);
+    QTest::addRow("string pool") << int(offsetof(SvgRectsCacheFile::Header, stringPoolSize)) << quint32(0x7fffffff);
+    QTest::addRow("path table") << int(offsetof(SvgRectsCacheFile::Header, pathTableOffset)) << quint32(0x7ffffff8);
+    QTest::addRow("path table capacity") << int(offsetof(SvgRectsCacheFile::Header, pathTableCapacity)) << quint32(3);
+}
+
+void SvgRectsCacheFileTest::corrupted()
+{
+    QFETCH(int, offset);
+    QFETCH(quint32, value);
+
+    const QString fileName = writeTestFile();
+    QVERIFY(!fileName.isEmpty());
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.seek(offset));
+    QCOMPARE(file.write(reinterpret_cast<const char *>(&value), sizeof(value)), qint64(sizeof(value)));
+    file.close();
+
+    SvgRectsCacheFile cacheFile;
+    QVERIFY(!cacheFile.open(fileName));
+}
+
+void SvgRectsCacheFileTest::corruptedSizeHint()
+{
+    const QString fileName = writeTestFile();
+    QVERIFY(!fileName.isEmpty());
+
+    SvgRectsCacheFile cacheFile;
+    QVERIFY(cacheFile.open(fileName));
+    const SvgRectsCacheFile::PathEntry *image = cacheFile.findImage(s_path);
+    QVERIFY(image);
+    QVERIFY(image->sizeHintsCount > 0);
+    const qint64 offset = image->sizeHintsOffset + offsetof(SvgRectsCacheFile::SizeHintRecord, idOffset);
+    cacheFile.close();
+
+    // An id pointing past the string pool
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.seek(offset));
+    const quint32 value = 0x7ffffff0;
+    QCOMPARE(file.write(reinterpret_cast<const char *>(&value), sizeof(value)), qint64(sizeof(value)));
+    file.close();
+
+    QVERIFY(!cacheFile.open(fileName));
+}
+
+void SvgRectsCacheFileTest::merge()
+{
+    const QString cacheFilePath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/ksvg-elements.bin");
+    QFile::remove(cacheFilePath);
+
+    // Two processes with the cache open at the same time, each syncing its own changes on exit
+    auto first = std::make_unique<KSvg::SvgRectsCache>();
+    auto second = std::make_unique<KSvg::SvgRectsCache>();
+    first->insert(1, s_path, QRectF(0, 0, 10, 10), 1700000000);
+    first->setNaturalSize(s_path, 1.0, QSizeF(100, 50));
+    second->insert(2, s_path, QRectF(0, 0, 20, 20), 1700000000);
+    second->insert(3, s_otherPath, QRectF(0, 0, 30, 30), 1600000000);
+    first.reset();
+    second.reset();
+
+    SvgRectsCacheFile file;
+    QVERIFY(file.open(cacheFilePath));
+    const SvgRectsCacheFile::PathEntry *image = file.findImage(s_path);
+    QVERIFY(image);
+    QRectF rect;
+    QVERIFY(file.findElementRect(image, 1, rect));
+    QCOMPARE(rect, QRectF(0, 0, 10, 10));
+    QVERIFY(file.findElementRect(image, 2, rect));
+    QCOMPARE(rect, QRectF(0, 0, 20, 20));
+    QCOMPARE(file.naturalSize(image, 1.0), QSizeF(100, 50));
+    QVERIFY(file.findElementRect(file.findImage(s_otherPath), 3, rect));
+    QCOMPARE(rect, QRectF(0, 0, 30, 30));
+    file.close();
+
+    // A newer version of the file replaces the rects of the old one
+    {
+        KSvg::SvgRectsCache cache;
+        cache.insert(4, s_path, QRectF(0, 0, 40, 40), 1800000000);
+    }
+    QVERIFY(file.open(cacheFilePath));
+    image = file.findImage(s_path);
+    QVERIFY(image);
+    QCOMPARE(image->lastModified, 1800000000u);
+    QVERIFY(!file.findElementRect(image, 1, rect));
+    QVERIFY(file.findElementRect(image, 4, rect));
+
+    QFile::remove(cacheFilePath);
+}
+
+void SvgRectsCacheFileTest::sizeHintsNotSynced()
+{
+    const QString cacheFilePath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/ksvg-elements.bin");
+    QFile::remove(cacheFilePath);
+
+    {
+        KSvg::SvgRectsCache cache;
+        cache.insertSizeHintForId(s_path, QStringLiteral("center"), QSize(16, 16));
+
+        // More lookups than the memo of the size hints holds
+        for (int i = 0; i < 5000; ++i) {
+            QVERIFY(cache.sizeHintsForId(s_path, QStringLiteral("element%1").arg(i)).isEmpty());
+        }
+
+        QCOMPARE(cache.sizeHintsForId(s_path, QStringLiteral("center")), QList<QSize>{QSize(16, 16)});
+        cache.insertSizeHintForId(s_path, QStringLiteral("center"), QSize(32, 32));
+        QCOMPARE(cache.sizeHintsForId(s_path, QStringLiteral("center")), (QList<QSize>{QSize(16, 16), QSize(32, 32)}));
+    }
+
+    SvgRectsCacheFile file;
+    QVERIFY(file.open(cacheFilePath));
+    QCOMPARE(file.sizeHintsForId(file.findImage(s_path), u"center"), (QList<QSize>{QSize(16, 16), QSize(32, 32)}));
+    file.close();
+
+    QFile::remove(cacheFilePath);
+}
+
+QTEST_MAIN(SvgRectsCacheFileTest)
@@ -0,0 +1,36 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#ifndef SVGRECTSCACHEFILETEST_H
+#define SVGRECTSCACHEFILETEST_H
+
+#include <QTemporaryDir>
+#include <QTest>
+
+class SvgRectsCacheFileTest : public QObject
+{
+    Q_OBJECT
+
+public Q_SLOTS:
+    void initTestCase();
+
+private Q_SLOTS:
+    void roundTrip();
+    void pathHash();
+    void truncated_data();
+    void truncated();
+    void corrupted_data();
+    void corrupted();
+    void corruptedSizeHint();
+    void merge();
+    void sizeHintsNotSynced();
+
+private:
+    QString writeTestFile();
+
+    QTemporaryDir m_dir;
+};
+
+#endif
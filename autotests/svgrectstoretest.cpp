@@ -0,0 +1,200 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "svgrectstoretest.h"
+
+#include <QSet>
+
+#include "ksvg/private/svg_p.h"
+#include "ksvg/private/svgrectstore_p.h"
+
+using KSvg::SvgAtom;
+using KSvg::SvgRectStore;
+
+static const SvgAtom *file()
+{
+    return SvgAtom::intern(u"/usr/share/ksvg/test/background.svgz");
+}
+
+static const SvgAtom *otherFile()
+{
+    return SvgAtom::intern(u"/usr/share/ksvg/test/background.svg");
+}
+
+void SvgRectStoreTest::findAndTombstones()
+{
+    SvgRectStore store;
+    QRectF rect(1, 2, 3, 4);
+    QCOMPARE(store.find(1, rect), SvgRectStore::Missing);
+    QVERIFY(!store.contains(1));
+
+    store.insert(1, file(), QRectF(0, 0, 10, 20));
+    store.insert(2, file(), QRectF());
+    QCOMPARE(store.size(), 2);
+
+    QCOMPARE(store.find(1, rect), SvgRectStore::Found);
+    QCOMPARE(rect, QRectF(0, 0, 10, 20));
+    QCOMPARE(store.find(2, rect), SvgRectStore::Tombstone);
+    QVERIFY(rect.isNull());
+    QCOMPARE(store.find(3, rect), SvgRectStore::Missing);
+
+    QVERIFY(store.contains(1));
+    QVERIFY(store.contains(2));
+    QVERIFY(!store.contains(3));
+}
+
+void SvgRectStoreTest::replace()
+{
+    SvgRectStore store;
+    store.insert(1, file(), QRectF(0, 0, 10, 20));
+    store.insert(1, file(), QRectF());
+    QCOMPARE(store.size(), 1);
+
+    QRectF rect;
+    QCOMPARE(store.find(1, rect), SvgRectStore::Tombstone);
+
+    store.insert(1, file(), QRectF(5, 5, 1, 1));
+    QCOMPARE(store.size(), 1);
+    QCOMPARE(store.find(1, rect), SvgRectStore::Found);
+    QCOMPARE(rect, QRectF(5, 5, 1, 1));
+}
+
+void SvgRectStoreTest::collidingKeys()
+{
+    // Same low bits: same first slot in the table
+    SvgRectStore store;
+    for (quint64 i = 0; i < 8; ++i) {
+        store.insert(i << 32 | 7, i % 2 ? file() : otherFile(), QRectF(0, 0, i + 1, 1));
+    }
+
+    store.removeFile(otherFile());
+    QCOMPARE(store.size(), 4);
+
+    for (quint64 i = 0; i < 8; ++i) {
+        QRectF rect;
+        if (i % 2) {
+            QCOMPARE(store.find(i << 32 | 7, rect), SvgRectStore::Found);
+            QCOMPARE(rect, QRectF(0, 0, i + 1, 1));
+        } else {
+            QCOMPARE(store.find(i << 32 | 7, rect), SvgRectStore::Missing);
+        }
+    }
+}
+
+void SvgRectStoreTest::removeFile()
+{
+    SvgRectStore store;
+    for (quint64 key = 1; key <= 100; ++key) {
+        store.insert(key, key <= 60 ? file() : otherFile(), key % 3 ? QRectF(0, 0, key, key) : QRectF());
+    }
+    QCOMPARE(store.size(), 100);
+
+    store.removeFile(file());
+    QCOMPARE(store.size(), 40);
+
+    QRectF rect;
+    QCOMPARE(store.find(1, rect), SvgRectStore::Missing);
+    QCOMPARE(store.find(60, rect), SvgRectStore::Missing);
+    QCOMPARE(store.find(61, rect), SvgRectStore::Found);
+    QCOMPARE(store.find(63, rect), SvgRectStore::Tombstone);
+
+    // Removing a file without rects changes nothing
+    store.removeFile(SvgAtom::intern(u"/usr/share/ksvg/test/unused.svg"));
+    QCOMPARE(store.size(), 40);
+}
+
+void SvgRectStoreTest::eviction()
+{
+    SvgRectStore store;
+    store.setMaximumSize(100);
+    for (quint64 key = 1; key <= 100; ++key) {
+        store.insert(key, file(), QRectF(0, 0, key, key));
+    }
+    QCOMPARE(store.size(), 100);
+
+    // The oldest ones, used again
+    QRectF rect;
+    for (quint64 key = 1; key <= 10; ++key) {
+        QCOMPARE(store.find(key, rect), SvgRectStore::Found);
+    }
+
+    store.insert(101, file(), QRectF(0, 0, 1, 1));
+    QVERIFY(store.size() <= 100);
+    QVERIFY(store.size() < 100 - 1);
+
+    for (quint64 key = 1; key <= 10; ++key) {
+        QCOMPARE(store.find(key, rect), SvgRectStore::Found);
+    }
+    QCOMPARE(store.find(101, rect), SvgRectStore::Found);
+    // The least recently used went first
+    QCOMPARE(store.find(11, rect), SvgRectStore::Missing);
+
+    // Shrinking evicts right away
+    store.setMaximumSize(20);
+    QVERIFY(store.size() <= 20);
+    QCOMPARE(store.find(101, rect), SvgRectStore::Found);
+}
+
+void SvgRectStoreTest::growth()
+{
+    SvgRectStore store;
+    for (quint64 key = 1; key <= 10000; ++key) {
+        store.insert(key * 0x9e3779b97f4a7c15, file(), QRectF(0, 0, key, 1));
+    }
+    QCOMPARE(store.size(), 10000);
+
+    for (quint64 key = 1; key <= 10000; ++key) {
+        QRectF rect;
+        QCOMPARE(store.find(key * 0x9e3779b97f4a7c15, rect), SvgRectStore::Found);
+        QCOMPARE(rect.width(), qreal(key));
+    }
+}
+
+void SvgRectStoreTest::cacheIdKeys()
+{
+    using CacheId = KSvg::SvgPrivate::CacheId;
+
+    const SvgAtom *center = SvgAtom::intern(u"center");
+    QCOMPARE(SvgAtom::intern(QStringLiteral("center")), center);
+    // Element id hashes and fingerprints are stored in the rects cache file and checked by other processes
+    QCOMPARE(quint32(center->hash), 0x7f204dc6u);
+    QCOMPARE(quint32(SvgAtom::intern(u"widgets/background")->fingerprint), 0xc8f92e15u);
+
+    const CacheId id(64, 32, file(), center, 0, 1.0, 42, 0, 1700000000);
+    const CacheId same(64, 32, file(), center, 0, 1.0, 42, 0, 1700000000);
+    QCOMPARE(id.key(), same.key());
+    QCOMPARE(id.pixmapKey(), same.pixmapKey());
+
+    const QList<CacheId> others = {
+        CacheId(32, 64, file(), center, 0, 1.0, 42, 0, 1700000000),
+        CacheId(64, 32, otherFile(), center, 0, 1.0, 42, 0, 1700000000),
+        CacheId(64, 32, file(), SvgAtom::intern(u"top"), 0, 1.0, 42, 0, 1700000000),
+        CacheId(64, 32, file(), center, 1, 1.0, 42, 0, 1700000000),
+        CacheId(64, 32, file(), center, 0, 2.0, 42, 0, 1700000000),
+        CacheId(64, 32, file(), center, 0, 1.0, 43, 0, 1700000000),
+        CacheId(64, 32, file(), center, 0, 1.0, 42, 1, 1700000000),
+        CacheId(64, 32, file(), center, 0, 1.0, 42, 0, 1700000001),
+    };
+
+    QSet<QString> pixmapKeys = {id.pixmapKey()};
+    for (const CacheId &other : others) {
+        QVERIFY(other.key() != id.key());
+        pixmapKeys.insert(other.pixmapKey());
+    }
+    QCOMPARE(pixmapKeys.size(), others.size() + 1);
+
+    for (const QString &pixmapKey : std::as_const(pixmapKeys)) {
+        QCOMPARE(pixmapKey.size(), 5);
+        for (const QChar c : pixmapKey) {
+            QVERIFY(c.unicode() >= 0x100);
+            QVERIFY(!c.isSurrogate());
+        }
+        // What KSharedDataCache does with the keys
+        QCOMPARE(QString::fromUtf8(pixmapKey.toUtf8()), pixmapKey);
+    }
+}
+
+QTEST_MAIN(SvgRectStoreTest)
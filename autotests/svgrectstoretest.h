@@ -0,0 +1,25 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#ifndef SVGRECTSTORETEST_H
+#define SVGRECTSTORETEST_H
+
+#include <QTest>
+
+class SvgRectStoreTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void findAndTombstones();
+    void replace();
+    void collidingKeys();
+    void removeFile();
+    void eviction();
+    void growth();
+    void cacheIdKeys();
+};
+
+#endif
@@ -0,0 +1,142 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "svgtest.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFuture>
+#include <QSignalSpy>
+#include <QStandardPaths>
+
+#include "ksvg/statistics.h"
+#include "ksvg/svg.h"
+
+void SvgTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    m_cacheDir = QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation));
+    m_cacheDir.removeRecursively();
+
+    m_svgPath = QFINDTESTDATA("data/background.svgz");
+    QVERIFY(!m_svgPath.isEmpty());
+    QVERIFY(m_dir.isValid());
+}
+
+void SvgTest::cleanupTestCase()
+{
+    m_cacheDir.removeRecursively();
+}
+
+QString SvgTest::copyTestFile(const QString &name)
+{
+    const QString path = m_dir.filePath(name);
+    QFile::remove(path);
+    if (!QFile::copy(m_svgPath, path)) {
+        return QString();
+    }
+    return path;
+}
+
+void SvgTest::imageAsync()
+{
+    KSvg::Svg svg;
+    svg.setImagePath(m_svgPath);
+    QVERIFY(svg.isValid());
+    svg.setUsingRenderingCache(false);
+
+    QFuture<QImage> future = svg.imageAsync(QSize(64, 32), QStringLiteral("center"));
+    future.waitForFinished();
+    const QImage image = future.result();
+    QCOMPARE(image.size(), QSize(64, 32));
+
+    const QImage expected = svg.image(QSize(64, 32), QStringLiteral("center"));
+    QCOMPARE(image.convertToFormat(QImage::Format_ARGB32_Premultiplied), expected.convertToFormat(QImage::Format_ARGB32_Premultiplied));
+
+    // The whole document when there's no element
+    future = svg.imageAsync(QSize(20, 20));
+    future.waitForFinished();
+    QCOMPARE(future.result().size(), QSize(20, 20));
+}
+
+void SvgTest::imageAsyncReleasesRenderer()
+{
+    const QString path = copyTestFile(QStringLiteral("async.svgz"));
+    QVERIFY(!path.isEmpty());
+
+    const qint64 renderers = KSvg::Statistics::gauge(KSvg::Statistics::Renderers);
+    const qint64 documents = KSvg::Statistics::gauge(KSvg::Statistics::Documents);
+
+    QList<QFuture<QImage>> futures;
+    {
+        KSvg::Svg svg;
+        svg.setImagePath(path);
+        svg.setUsingRenderingCache(false);
+        for (int size = 16; size <= 256; size *= 2) {
+            futures << svg.imageAsync(QSize(size, size), QStringLiteral("center"));
+        }
+        // The svg goes away while its jobs still hold its renderer
+    }
+
+    for (QFuture<QImage> &future : futures) {
+        future.waitForFinished();
+        QVERIFY(!future.result().isNull());
+    }
+
+    // Once the last job is done with it, nothing is left of that file in the shared caches
+    QTRY_COMPARE(KSvg::Statistics::gauge(KSvg::Statistics::Renderers), renderers);
+    QTRY_COMPARE(KSvg::Statistics::gauge(KSvg::Statistics::Documents), documents);
+}
+
+static bool writeSvg(const QString &path, const char *elementId)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QByteArray("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"48\" height=\"32\"><rect id=\"") + elementId
+               + "\" x=\"2\" y=\"4\" width=\"20\" height=\"10\"/></svg>");
+    // Modification times are compared in seconds: make the next write a change
+    return file.flush() && file.setFileTime(QDateTime::currentDateTime().addSecs(-60), QFileDevice::FileModificationTime);
+}
+
+void SvgTest::fileChanged()
+{
+    const QString path = m_dir.filePath(QStringLiteral("changing.svg"));
+    const QString otherPath = m_dir.filePath(QStringLiteral("changing.svgz"));
+    QVERIFY(writeSvg(path, "before"));
+    QVERIFY(writeSvg(otherPath, "before"));
+
+    KSvg::Svg svg;
+    svg.setImagePath(path);
+    QVERIFY(svg.isValid());
+    QVERIFY(svg.hasElement(QStringLiteral("before")));
+    QVERIFY(!svg.hasElement(QStringLiteral("after")));
+
+    KSvg::Svg otherSvg;
+    otherSvg.setImagePath(otherPath);
+    QVERIFY(otherSvg.hasElement(QStringLiteral("before")));
+
+    QSignalSpy repaintNeeded(&svg, &KSvg::Svg::repaintNeeded);
+    QSignalSpy otherRepaintNeeded(&otherSvg, &KSvg::Svg::repaintNeeded);
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"64\" height=\"64\"><rect id=\"after\" x=\"8\" y=\"8\" width=\"30\" height=\"30\"/></svg>");
+    file.close();
+
+    // The rects cached for the previous content are dropped with it
+    QTRY_VERIFY(repaintNeeded.count() > 0);
+    QVERIFY(svg.hasElement(QStringLiteral("after")));
+    QVERIFY(!svg.hasElement(QStringLiteral("before")));
+    QVERIFY(svg.elementRect(QStringLiteral("after")).isValid());
+
+    // Files with a path starting like the one that changed are left alone
+    QCOMPARE(otherRepaintNeeded.count(), 0);
+    QVERIFY(otherSvg.hasElement(QStringLiteral("before")));
+}
+
+QTEST_MAIN(SvgTest)
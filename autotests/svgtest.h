@@ -0,0 +1,35 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#ifndef SVGTEST_H
+#define SVGTEST_H
+
+#include <QDir>
+#include <QTemporaryDir>
+#include <QTest>
+
+class SvgTest : public QObject
+{
+    Q_OBJECT
+
+public Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+private Q_SLOTS:
+    void imageAsync();
+    void imageAsyncReleasesRenderer();
+    void fileChanged();
+
+private:
+    // A copy of background.svgz only used by the calling test, so that it has its own renderer
+    QString copyTestFile(const QString &name);
+
+    QString m_svgPath;
+    QTemporaryDir m_dir;
+    QDir m_cacheDir;
+};
+
+#endif
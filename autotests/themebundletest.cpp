@@ -0,0 +1,168 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "themebundletest.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSvgRenderer>
+
+#include <KCompressionDevice>
+
+#include "ksvg/private/themebundle_p.h"
+#include "ksvg/private/themecompiler_p.h"
+
+using KSvg::ThemeBundle;
+
+static const char s_widgetSvg[] =
+    "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"48\" height=\"32\">"
+    "<rect id=\"base\" x=\"2\" y=\"4\" width=\"20\" height=\"10\"/>"
+    "<g id=\"moved\" transform=\"translate(10 5)\"><rect x=\"0\" y=\"0\" width=\"8\" height=\"8\"/></g>"
+    "<rect id=\"16-16-base\" x=\"0\" y=\"0\" width=\"16\" height=\"16\"/>"
+    "</svg>";
+
+static QByteArray readDocument(const QString &path)
+{
+    KCompressionDevice device(path, KCompressionDevice::GZip);
+    if (!device.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return device.readAll();
+}
+
+void ThemeBundleTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_themeDir = m_dir.filePath(QStringLiteral("testtheme"));
+    QVERIFY(QDir().mkpath(m_themeDir + QStringLiteral("/widgets")));
+
+    const QString background = QFINDTESTDATA("data/background.svgz");
+    QVERIFY(!background.isEmpty());
+    QVERIFY(QFile::copy(background, m_themeDir + QStringLiteral("/widgets/background.svgz")));
+
+    QFile widget(m_themeDir + QStringLiteral("/widgets/widget.svg"));
+    QVERIFY(widget.open(QIODevice::WriteOnly));
+    widget.write(s_widgetSvg);
+    widget.close();
+
+    QString error;
+    QVERIFY2(KSvg::compileThemeBundle(m_themeDir, m_themeDir + QLatin1Char('/') + QLatin1String(ThemeBundle::s_fileName), &error), qPrintable(error));
+}
+
+void ThemeBundleTest::roundTrip_data()
+{
+    QTest::addColumn<QString>("relativePath");
+
+    QTest::newRow("svgz") << QStringLiteral("widgets/background.svgz");
+    QTest::newRow("svg") << QStringLiteral("widgets/widget.svg");
+}
+
+void ThemeBundleTest::roundTrip()
+{
+    QFETCH(QString, relativePath);
+
+    const ThemeBundle::Ptr bundle = ThemeBundle::open(m_themeDir);
+    QVERIFY(bundle);
+    QCOMPARE(bundle->directory(), m_themeDir);
+
+    const ThemeBundle::ImageEntry *image = bundle->findImage(relativePath);
+    QVERIFY(image);
+    QVERIFY(!bundle->findImage(QStringLiteral("widgets/missing.svg")));
+
+    const QString path = m_themeDir + QLatin1Char('/') + relativePath;
+    const QByteArray contents = readDocument(path);
+    QVERIFY(!contents.isEmpty());
+    QCOMPARE(bundle->document(image), contents);
+
+    QSvgRenderer renderer(contents);
+    QVERIFY(renderer.isValid());
+    QCOMPARE(bundle->defaultSize(image), QSizeF(renderer.defaultSize()));
+
+    const KSvg::SvgDocument::Index index = KSvg::SvgDocument::index(contents);
+    const KSvg::SvgDocument::Index bundleIndex = bundle->index(image);
+    QCOMPARE(bundleIndex.colorSchemeStyles.size(), index.colorSchemeStyles.size());
+    for (qsizetype i = 0; i < index.colorSchemeStyles.size(); ++i) {
+        QCOMPARE(bundleIndex.colorSchemeStyles[i].start, index.colorSchemeStyles[i].start);
+        QCOMPARE(bundleIndex.colorSchemeStyles[i].end, index.colorSchemeStyles[i].end);
+        QCOMPARE(bundleIndex.colorSchemeStyles[i].selfClosing, index.colorSchemeStyles[i].selfClosing);
+    }
+    QVERIFY(!index.elementIds.isEmpty());
+
+    QHash<QString, QRectF> sizeHinted;
+    for (const KSvg::SvgDocument::ElementId &elementId : index.elementIds) {
+        const QString id = QString::fromUtf8(contents.mid(elementId.start, elementId.length));
+        const QRectF bounds = renderer.boundsOnElement(id);
+        const QRectF expected = renderer.elementExists(id) ? renderer.transformForElement(id).map(bounds).boundingRect() : QRectF();
+
+        QRectF rect;
+        QVERIFY2(bundle->findElementRect(image, id, rect), qPrintable(id));
+        QCOMPARE(rect, expected);
+
+        if (elementId.sizeHintLength > 0 && bounds.isValid()) {
+            sizeHinted.insert(id, bounds);
+        }
+    }
+    QCOMPARE(bundle->sizeHintedElements(image), sizeHinted);
+
+    QRectF rect;
+    QVERIFY(!bundle->findElementRect(image, QStringLiteral("no-such-element"), rect));
+
+    const uint lastModified = QFileInfo(path).lastModified().toSecsSinceEpoch();
+    const ThemeBundle::ImageEntry *found = nullptr;
+    QCOMPARE(ThemeBundle::findFile(path, lastModified, &found), bundle);
+    QCOMPARE(found, image);
+    // Modified after the bundle was compiled
+    QVERIFY(!ThemeBundle::findFile(path, lastModified + 1, &found));
+}
+
+void ThemeBundleTest::stableHashes()
+{
+    const ThemeBundle::Ptr bundle = ThemeBundle::open(m_themeDir);
+    QVERIFY(bundle);
+
+    // Bundles are read by other processes than the one that compiled them
+    const ThemeBundle::ImageEntry *image = bundle->findImage(QStringLiteral("widgets/background.svgz"));
+    QVERIFY(image);
+    QCOMPARE(image->hash, 0xb4e006a5u);
+}
+
+void ThemeBundleTest::recompiled()
+{
+    const QString fileName = m_themeDir + QLatin1Char('/') + QLatin1String(ThemeBundle::s_fileName);
+    ThemeBundle::Ptr bundle = ThemeBundle::open(m_themeDir);
+    QVERIFY(bundle);
+    QCOMPARE(ThemeBundle::open(m_themeDir), bundle);
+    QVERIFY(!bundle->findImage(QStringLiteral("widgets/added.svg")));
+    // Loaded from the mapped bundle
+    const KSvg::SvgDocument::Ptr document(new KSvg::SvgDocument(m_themeDir + QStringLiteral("/widgets/widget.svg")));
+
+    QVERIFY(QFile::copy(m_themeDir + QStringLiteral("/widgets/widget.svg"), m_themeDir + QStringLiteral("/widgets/added.svg")));
+    QString error;
+    QVERIFY2(KSvg::compileThemeBundle(m_themeDir, fileName, &error), qPrintable(error));
+    // Within the resolution of the modification times otherwise
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(10), QFileDevice::FileModificationTime));
+    file.close();
+
+    const ThemeBundle::Ptr recompiled = ThemeBundle::open(m_themeDir);
+    QVERIFY(recompiled);
+    QVERIFY(recompiled != bundle);
+    QVERIFY(recompiled->findImage(QStringLiteral("widgets/added.svg")));
+    // The previous one stays valid for who still holds it
+    QVERIFY(bundle->findImage(QStringLiteral("widgets/widget.svg")));
+
+    QVERIFY(QFile::remove(fileName));
+    QVERIFY(!ThemeBundle::open(m_themeDir));
+
+    // Documents keep the bundle they were loaded from mapped
+    bundle.reset();
+    QCOMPARE(document->contents(), QByteArray(s_widgetSvg));
+}
+
+QTEST_MAIN(ThemeBundleTest)
@@ -0,0 +1,30 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#ifndef THEMEBUNDLETEST_H
+#define THEMEBUNDLETEST_H
+
+#include <QTemporaryDir>
+#include <QTest>
+
+class ThemeBundleTest : public QObject
+{
+    Q_OBJECT
+
+public Q_SLOTS:
+    void initTestCase();
+
+private Q_SLOTS:
+    void roundTrip_data();
+    void roundTrip();
+    void stableHashes();
+    void recompiled();
+
+private:
+    QString m_themeDir;
+    QTemporaryDir m_dir;
+};
+
+#endif
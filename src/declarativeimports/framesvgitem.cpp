@@ -12,7 +12,9 @@
 
 #include <QQuickWindow>
 #include <QSGGeometry>
+#include <QSGGeometryNode>
 #include <QSGTexture>
+#include <QSGTextureMaterial>
 
 #include <QDebug>
 #include <QPainter>
@@ -20,24 +22,64 @@
 #include <ksvg/private/framesvg_helpers.h>
 #include <ksvg/private/framesvg_p.h>
 
+#include <algorithm>
+#include <array>
 #include <cmath> //floor()
 
 #include <Kirigami/PlatformTheme>
 
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+#include <rhi/qrhi.h>
+#endif
+
 namespace KSvg
 {
 Q_GLOBAL_STATIC(ImageTexturesCache, s_cache)
 
-class FrameNode : public QSGNode
+static int maximumTextureSize(QQuickWindow *window)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+    if (QRhi *rhi = window->rhi()) {
+        return rhi->resourceLimit(QRhi::TextureSizeMax);
+    }
+#else
+    Q_UNUSED(window)
+#endif
+    // Supported by about every GPU still in use
+    return 4096;
+}
+
+/**
+ * Draws the whole frame with a single geometry node: all the sections of the
+ * frame are rendered into one atlas image, and each of them is drawn as one or
+ * more textured quads of that same texture, so the frame needs one draw call.
+ *
+ * A stretched center that would make the atlas bigger than the maximum texture
+ * size is drawn by a child node with its own texture instead.
+ */
+class FrameNode : public QSGGeometryNode
 {
 public:
-    FrameNode(const QString &prefix, FrameSvg *svg)
-        : QSGNode()
+    enum FitMode {
+        // render SVG at native resolution then stretch it in openGL
+        FastStretch,
+        // on resize re-render the part of the frame from the SVG
+        Stretch,
+        Tile,
+    };
+
+    FrameNode(FrameSvgItem *frameSvgItem, FitMode borderFitMode, FitMode centerFitMode)
+        : QSGGeometryNode()
+        , m_frameSvgItem(frameSvgItem)
+        , m_geometry(QSGGeometry::defaultAttributes_TexturedPoint2D(), 0)
         , leftWidth(0)
         , rightWidth(0)
         , topHeight(0)
         , bottomHeight(0)
     {
+        FrameSvg *svg = m_frameSvgItem->frameSvg();
+        const QString prefix = svg->actualPrefix();
+
         if (svg->enabledBorders() & FrameSvg::LeftBorder) {
             leftWidth = svg->elementSize(prefix % QLatin1String("left")).width();
         }
@@ -50,6 +92,37 @@ public:
         if (svg->enabledBorders() & FrameSvg::BottomBorder) {
             bottomHeight = svg->elementSize(prefix % QLatin1String("bottom")).height();
         }
+
+        const FrameSvg::EnabledBorders borders = m_frameSvgItem->enabledBorders();
+        addSection(FrameSvg::NoBorder, centerFitMode);
+        if (borders & (FrameSvg::TopBorder | FrameSvg::LeftBorder)) {
+            addSection(FrameSvg::TopBorder | FrameSvg::LeftBorder, FastStretch);
+        }
+        if (borders & (FrameSvg::TopBorder | FrameSvg::RightBorder)) {
+            addSection(FrameSvg::TopBorder | FrameSvg::RightBorder, FastStretch);
+        }
+        if (borders & FrameSvg::TopBorder) {
+            addSection(FrameSvg::TopBorder, borderFitMode);
+        }
+        if (borders & FrameSvg::BottomBorder) {
+            addSection(FrameSvg::BottomBorder, borderFitMode);
+        }
+        if (borders & (FrameSvg::BottomBorder | FrameSvg::LeftBorder)) {
+            addSection(FrameSvg::BottomBorder | FrameSvg::LeftBorder, FastStretch);
+        }
+        if (borders & (FrameSvg::BottomBorder | FrameSvg::RightBorder)) {
+            addSection(FrameSvg::BottomBorder | FrameSvg::RightBorder, FastStretch);
+        }
+        if (borders & FrameSvg::LeftBorder) {
+            addSection(FrameSvg::LeftBorder, borderFitMode);
+        }
+        if (borders & FrameSvg::RightBorder) {
+            addSection(FrameSvg::RightBorder, borderFitMode);
+        }
+
+        m_geometry.setDrawingMode(QSGGeometry::DrawTriangles);
+        setGeometry(&m_geometry);
+        setMaterial(&m_material);
     }
 
     QRect contentsRect(const QSize &size) const
@@ -59,113 +132,343 @@ public:
         return QRect(QPoint(leftWidth, topHeight), contentSize);
     }
 
-private:
-    int leftWidth;
-    int rightWidth;
-    int topHeight;
-    int bottomHeight;
-};
-
-class FrameItemNode : public ManagedTextureNode
-{
-public:
-    enum FitMode {
-        // render SVG at native resolution then stretch it in openGL
-        FastStretch,
-        // on resize re-render the part of the frame from the SVG
-        Stretch,
-        Tile,
-    };
+    void setFiltering(QSGTexture::Filtering filtering)
+    {
+        if (m_material.filtering() != filtering) {
+            m_material.setFiltering(filtering);
+            markDirty(QSGNode::DirtyMaterial);
+        }
+        if (m_centerNode) {
+            m_centerNode->setFiltering(filtering);
+        }
+    }
 
-    FrameItemNode(FrameSvgItem *frameSvg, FrameSvg::EnabledBorders borders, FitMode fitMode, QSGNode *parent)
-        : ManagedTextureNode()
-        , m_frameSvg(frameSvg)
-        , m_border(borders)
-        , m_fitMode(fitMode)
+    void reposition(const QSize &fullSize)
     {
-        parent->appendChildNode(this);
+        const QRect frameGeometry = contentsRect(fullSize);
+        const bool firstLayout = !m_texture;
+        bool atlasChanged = firstLayout;
+
+        for (Section &section : m_sections) {
+            section.nodeRect = FrameSvgHelpers::sectionRect(section.border, frameGeometry, fullSize);
 
-        if (m_fitMode == Tile) {
-            if (m_border == FrameSvg::TopBorder || m_border == FrameSvg::BottomBorder || m_border == FrameSvg::NoBorder) {
-                static_cast<QSGTextureMaterial *>(material())->setHorizontalWrapMode(QSGTexture::Repeat);
-                static_cast<QSGOpaqueTextureMaterial *>(opaqueMaterial())->setHorizontalWrapMode(QSGTexture::Repeat);
+            // ensure we're not passing a weird rectangle to the geometry
+            if (!section.nodeRect.isValid() || section.nodeRect.isEmpty()) {
+                section.nodeRect = QRect();
             }
-            if (m_border == FrameSvg::LeftBorder || m_border == FrameSvg::RightBorder || m_border == FrameSvg::NoBorder) {
-                static_cast<QSGTextureMaterial *>(material())->setVerticalWrapMode(QSGTexture::Repeat);
-                static_cast<QSGOpaqueTextureMaterial *>(opaqueMaterial())->setVerticalWrapMode(QSGTexture::Repeat);
+
+            // Only the stretched sections get re-rendered at the new size, the others keep their image
+            if (firstLayout || (section.fitMode == Stretch && section.nodeRect.size() != section.renderedSize)) {
+                renderSection(section);
+                atlasChanged = true;
             }
         }
 
-        if (m_fitMode == Tile || m_fitMode == FastStretch) {
-            QString elementId = m_frameSvg->frameSvg()->actualPrefix() + FrameSvgHelpers::borderToElementId(m_border);
-            m_elementNativeSize = m_frameSvg->frameSvg()->elementSize(elementId);
+        if (atlasChanged) {
+            updateAtlas();
+        }
+
+        updateGeometry();
+    }
+
+private:
+    struct Section {
+        FrameSvg::EnabledBorders border;
+        FitMode fitMode;
+        QString elementId;
+        QSize elementNativeSize;
+        QSize renderedSize;
+        // What the section has in the atlas
+        QImage image;
+        // Geometry of the section in the item
+        QRect nodeRect;
+        // Position of the section image in the atlas, excluding its padding
+        QRect atlasRect;
+    };
+
+    // Tiles are repeated in the atlas up to at least this size, to keep the amount of quads low
+    static constexpr int s_minimumTileBlock = 64;
+
+    static bool tilesHorizontally(FrameSvg::EnabledBorders border)
+    {
+        return border == FrameSvg::TopBorder || border == FrameSvg::BottomBorder || border == FrameSvg::NoBorder;
+    }
+
+    static bool tilesVertically(FrameSvg::EnabledBorders border)
+    {
+        return border == FrameSvg::LeftBorder || border == FrameSvg::RightBorder || border == FrameSvg::NoBorder;
+    }
+
+    // Rows of the atlas, from top to bottom: the stretched sections are as big as the item in one
+    // direction, so they get rows of their own and the atlas stays about the size of the item
+    enum AtlasRow {
+        // Stretched center, left and right edges, as high as the center
+        MiddleRow,
+        // Stretched top and bottom edges, as wide as the center
+        TopRow,
+        BottomRow,
+        // Corners and tiles, at their native size
+        FixedRow,
+        AtlasRowCount,
+    };
+
+    static AtlasRow atlasRow(const Section &section)
+    {
+        if (section.fitMode != Stretch) {
+            return FixedRow;
+        }
+        if (section.border == FrameSvg::TopBorder) {
+            return TopRow;
+        }
+        if (section.border == FrameSvg::BottomBorder) {
+            return BottomRow;
+        }
+        return MiddleRow;
+    }
+
+    static bool isStretchedCenter(const Section &section)
+    {
+        return section.border == FrameSvg::NoBorder && section.fitMode == Stretch;
+    }
+
+    void addSection(FrameSvg::EnabledBorders border, FitMode fitMode)
+    {
+        Section section;
+        section.border = border;
+        section.fitMode = fitMode;
+        section.elementId = m_frameSvgItem->frameSvg()->actualPrefix() + FrameSvgHelpers::borderToElementId(border);
+
+        if (fitMode == Tile || fitMode == FastStretch) {
+            section.elementNativeSize = m_frameSvgItem->frameSvg()->elementSize(section.elementId);
 
-            if (m_elementNativeSize.isEmpty()) {
+            if (section.elementNativeSize.isEmpty()) {
                 // if the default element is empty, we can avoid the slower tiling path
                 // this also avoids a divide by 0 error
-                m_fitMode = FastStretch;
+                section.fitMode = FastStretch;
             }
+        }
+
+        m_sections.append(section);
+    }
 
-            updateTexture(m_elementNativeSize, elementId);
+    void renderSection(Section &section)
+    {
+        section.renderedSize = section.fitMode == Stretch ? section.nodeRect.size() : section.elementNativeSize;
+        section.image = section.renderedSize.isEmpty() ? QImage() : sectionImage(section);
+    }
+
+    QImage sectionImage(const Section &section) const
+    {
+        QImage image = m_frameSvgItem->frameSvg()->image(section.renderedSize, section.elementId);
+        if (section.fitMode != Tile || image.isNull()) {
+            return image;
         }
+
+        // Repeat the tile in the image, tiling is then done by repeating quads of that block
+        const int horizontalCount = tilesHorizontally(section.border) ? std::ceil(qreal(s_minimumTileBlock) / image.width()) : 1;
+        const int verticalCount = tilesVertically(section.border) ? std::ceil(qreal(s_minimumTileBlock) / image.height()) : 1;
+        if (horizontalCount == 1 && verticalCount == 1) {
+            return image;
+        }
+
+        QImage block(image.width() * horizontalCount, image.height() * verticalCount, QImage::Format_ARGB32_Premultiplied);
+        block.fill(Qt::transparent);
+        QPainter painter(&block);
+        for (int y = 0; y < verticalCount; ++y) {
+            for (int x = 0; x < horizontalCount; ++x) {
+                painter.drawImage(x * image.width(), y * image.height(), image);
+            }
+        }
+        return block;
     }
 
-    void updateTexture(const QSize &size, const QString &elementId)
+    // Sets the atlasRect of the sections, and returns the size of the atlas
+    QSize layoutAtlas(bool withCenter)
     {
-        QQuickWindow::CreateTextureOptions options;
-        if (m_fitMode != Tile) {
-            options = QQuickWindow::TextureCanUseAtlas;
+        std::array<QSize, AtlasRowCount> rowSizes;
+        rowSizes.fill(QSize(0, 0));
+        for (const Section &section : std::as_const(m_sections)) {
+            if (!section.image.isNull() && (withCenter || !isStretchedCenter(section))) {
+                QSize &rowSize = rowSizes[atlasRow(section)];
+                rowSize.rwidth() += section.image.width() + 2;
+                rowSize.rheight() = std::max(rowSize.height(), section.image.height() + 2);
+            }
+        }
+
+        QSize atlasSize(0, 0);
+        std::array<QPoint, AtlasRowCount> rowPositions;
+        for (int row = 0; row < AtlasRowCount; ++row) {
+            rowPositions[row] = QPoint(0, atlasSize.height());
+            atlasSize.rwidth() = std::max(atlasSize.width(), rowSizes[row].width());
+            atlasSize.rheight() += rowSizes[row].height();
+        }
+
+        for (Section &section : m_sections) {
+            if (section.image.isNull() || (!withCenter && isStretchedCenter(section))) {
+                section.atlasRect = QRect();
+                continue;
+            }
+            QPoint &position = rowPositions[atlasRow(section)];
+            section.atlasRect = QRect(position + QPoint(1, 1), section.image.size());
+            position.rx() += section.image.width() + 2;
         }
-        setTexture(s_cache->loadTexture(m_frameSvg->window(), m_frameSvg->frameSvg()->image(size, elementId), options));
+
+        return atlasSize;
     }
 
-    void reposition(const QRect &frameGeometry, QSize &fullSize)
+    void updateAtlas()
     {
-        QRect nodeRect = FrameSvgHelpers::sectionRect(m_border, frameGeometry, fullSize);
+        QQuickWindow *window = m_frameSvgItem->window();
+        const int maximumSize = maximumTextureSize(window);
+        QSize atlasSize = layoutAtlas(true);
+        bool separateCenter = false;
+        if (atlasSize.width() > maximumSize || atlasSize.height() > maximumSize) {
+            atlasSize = layoutAtlas(false);
+            separateCenter = true;
+        }
+
+        // uploading a null image to QSGAtlasTexture causes a crash
+        QImage atlas(atlasSize.expandedTo(QSize(1, 1)), QImage::Format_ARGB32_Premultiplied);
+        atlas.fill(Qt::transparent);
+
+        // Each section has a one pixel padding so that linear filtering doesn't bleed between them.
+        // The padding replicates the edges of the section, except in the directions it's tiled in,
+        // where it's the opposite edge: the one the next tile starts with
+        QPainter painter(&atlas);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        for (const Section &section : std::as_const(m_sections)) {
+            const QImage &image = section.image;
+            if (section.atlasRect.isNull()) {
+                continue;
+            }
 
-        // ensure we're not passing a weird rectangle to updateTexturedRectGeometry
-        if (!nodeRect.isValid() || nodeRect.isEmpty()) {
-            nodeRect = QRect();
+            const int x = section.atlasRect.x() - 1;
+            const int y = section.atlasRect.y() - 1;
+            const int w = image.width();
+            const int h = image.height();
+
+            const bool wrapX = section.fitMode == Tile && tilesHorizontally(section.border);
+            const bool wrapY = section.fitMode == Tile && tilesVertically(section.border);
+            // Source column or row of the padding before and after the section
+            const int leftColumn = wrapX ? w - 1 : 0;
+            const int rightColumn = wrapX ? 0 : w - 1;
+            const int topRow = wrapY ? h - 1 : 0;
+            const int bottomRow = wrapY ? 0 : h - 1;
+
+            painter.drawImage(section.atlasRect, image);
+            painter.drawImage(QRect(x + 1, y, w, 1), image, QRect(0, topRow, w, 1));
+            painter.drawImage(QRect(x + 1, y + h + 1, w, 1), image, QRect(0, bottomRow, w, 1));
+            painter.drawImage(QRect(x, y + 1, 1, h), image, QRect(leftColumn, 0, 1, h));
+            painter.drawImage(QRect(x + w + 1, y + 1, 1, h), image, QRect(rightColumn, 0, 1, h));
+            painter.drawImage(QRect(x, y, 1, 1), image, QRect(leftColumn, topRow, 1, 1));
+            painter.drawImage(QRect(x + w + 1, y, 1, 1), image, QRect(rightColumn, topRow, 1, 1));
+            painter.drawImage(QRect(x, y + h + 1, 1, 1), image, QRect(leftColumn, bottomRow, 1, 1));
+            painter.drawImage(QRect(x + w + 1, y + h + 1, 1, 1), image, QRect(rightColumn, bottomRow, 1, 1));
         }
+        painter.end();
 
-        // the position of the relevant texture within this texture ID.
-        // for atlas' this will only be a small part of the texture
-        QRectF textureRect;
+        m_atlasSize = atlas.size();
+        m_texture = s_cache->loadTexture(window, atlas, QQuickWindow::TextureCanUseAtlas);
+        m_material.setTexture(m_texture.data());
+        markDirty(QSGNode::DirtyMaterial);
 
-        if (m_fitMode == Tile) {
-            textureRect = QRectF(0, 0, 1, 1); // we can never be in an atlas for tiled images.
+        updateCenterNode(separateCenter);
+    }
 
-            // if tiling horizontally
-            if (m_border == FrameSvg::TopBorder || m_border == FrameSvg::BottomBorder || m_border == FrameSvg::NoBorder) {
-                // cmp. CSS3's border-image-repeat: "repeat", though with first tile not centered, but aligned to left
-                textureRect.setWidth((qreal)nodeRect.width() / m_elementNativeSize.width());
+    void updateCenterNode(bool separateCenter)
+    {
+        const auto center = std::find_if(m_sections.cbegin(), m_sections.cend(), isStretchedCenter);
+        if (!separateCenter || center == m_sections.cend() || center->image.isNull()) {
+            if (m_centerNode) {
+                removeChildNode(m_centerNode);
+                delete m_centerNode;
+                m_centerNode = nullptr;
             }
-            // if tiling vertically
-            if (m_border == FrameSvg::LeftBorder || m_border == FrameSvg::RightBorder || m_border == FrameSvg::NoBorder) {
-                // cmp. CSS3's border-image-repeat: "repeat", though with first tile not centered, but aligned to top
-                textureRect.setHeight((qreal)nodeRect.height() / m_elementNativeSize.height());
+            return;
+        }
+
+        if (!m_centerNode) {
+            m_centerNode = new ManagedTextureNode;
+            m_centerNode->setFiltering(m_material.filtering());
+            appendChildNode(m_centerNode);
+        }
+        m_centerNode->setTexture(s_cache->loadTexture(m_frameSvgItem->window(), center->image));
+        m_centerNode->setRect(center->nodeRect);
+    }
+
+    void updateGeometry()
+    {
+        QList<QSGGeometry::TexturedPoint2D> vertices;
+
+        // the position of the atlas within the texture, which can itself be part of a bigger atlas
+        const QRectF subRect = m_texture->normalizedTextureSubRect();
+        auto textureRect = [this, &subRect](const QRectF &atlasRect) {
+            return QRectF(subRect.x() + atlasRect.x() / m_atlasSize.width() * subRect.width(),
+                          subRect.y() + atlasRect.y() / m_atlasSize.height() * subRect.height(),
+                          atlasRect.width() / m_atlasSize.width() * subRect.width(),
+                          atlasRect.height() / m_atlasSize.height() * subRect.height());
+        };
+        auto addQuad = [&vertices](const QRectF &rect, const QRectF &texture) {
+            QSGGeometry::TexturedPoint2D topLeft;
+            QSGGeometry::TexturedPoint2D topRight;
+            QSGGeometry::TexturedPoint2D bottomLeft;
+            QSGGeometry::TexturedPoint2D bottomRight;
+            topLeft.set(rect.left(), rect.top(), texture.left(), texture.top());
+            topRight.set(rect.right(), rect.top(), texture.right(), texture.top());
+            bottomLeft.set(rect.left(), rect.bottom(), texture.left(), texture.bottom());
+            bottomRight.set(rect.right(), rect.bottom(), texture.right(), texture.bottom());
+            vertices << topLeft << bottomLeft << topRight << topRight << bottomLeft << bottomRight;
+        };
+
+        for (const Section &section : std::as_const(m_sections)) {
+            if (section.nodeRect.isNull() || section.atlasRect.isNull()) {
+                continue;
             }
-        } else if (m_fitMode == Stretch) {
-            QString prefix = m_frameSvg->frameSvg()->actualPrefix();
 
-            QString elementId = prefix + FrameSvgHelpers::borderToElementId(m_border);
+            if (section.fitMode != Tile) {
+                addQuad(section.nodeRect, textureRect(section.atlasRect));
+                continue;
+            }
 
-            // re-render the SVG at new size
-            updateTexture(nodeRect.size(), elementId);
-            textureRect = texture()->normalizedTextureSubRect();
-        } else if (texture()) { // for fast stretch.
-            textureRect = texture()->normalizedTextureSubRect();
+            // cmp. CSS3's border-image-repeat: "repeat", though with first tile not centered, but aligned to the top left
+            // The block is repeated as is, the last one being cut to fit; when not tiling in a direction it's stretched
+            const bool horizontal = tilesHorizontally(section.border);
+            const bool vertical = tilesVertically(section.border);
+            const qreal right = section.nodeRect.x() + section.nodeRect.width();
+            const qreal bottom = section.nodeRect.y() + section.nodeRect.height();
+            const qreal stepX = horizontal ? section.atlasRect.width() : section.nodeRect.width();
+            const qreal stepY = vertical ? section.atlasRect.height() : section.nodeRect.height();
+
+            for (qreal y = section.nodeRect.y(); y < bottom; y += stepY) {
+                const qreal height = std::min(stepY, bottom - y);
+                for (qreal x = section.nodeRect.x(); x < right; x += stepX) {
+                    const qreal width = std::min(stepX, right - x);
+                    const QRectF source(section.atlasRect.x(),
+                                        section.atlasRect.y(),
+                                        horizontal ? width : section.atlasRect.width(),
+                                        vertical ? height : section.atlasRect.height());
+                    addQuad(QRectF(x, y, width, height), textureRect(source));
+                }
+            }
         }
 
-        QSGGeometry::updateTexturedRectGeometry(geometry(), nodeRect, textureRect);
+        m_geometry.allocate(vertices.size());
+        std::copy(vertices.constBegin(), vertices.constEnd(), m_geometry.vertexDataAsTexturedPoint2D());
         markDirty(QSGNode::DirtyGeometry);
     }
 
-private:
-    FrameSvgItem *m_frameSvg;
-    FrameSvg::EnabledBorders m_border;
-    QSize m_elementNativeSize;
-    FitMode m_fitMode;
+    FrameSvgItem *m_frameSvgItem;
+    QSGGeometry m_geometry;
+    QSGTextureMaterial m_material;
+    QSharedPointer<QSGTexture> m_texture;
+    QSize m_atlasSize;
+    // Draws the stretched center when it doesn't fit in the atlas, owned by this node
+    ManagedTextureNode *m_centerNode = nullptr;
+    QList<Section> m_sections;
+    int leftWidth;
+    int rightWidth;
+    int topHeight;
+    int bottomHeight;
 };
 
 FrameSvgItemMargins::FrameSvgItemMargins(KSvg::FrameSvg *frameSvg, QObject *parent)
@@ -575,60 +878,25 @@ QSGNode *FrameSvgItem::updatePaintNode(QSGNode *oldNode, QQuickItem::UpdatePaint
 
         if (!oldNode) {
             QString prefix = m_frameSvg->actualPrefix();
-            oldNode = new FrameNode(prefix, m_frameSvg);
 
             bool tileCenter = (m_frameSvg->hasElement(QStringLiteral("hint-tile-center")) //
                                || m_frameSvg->hasElement(prefix % QLatin1String("hint-tile-center")));
             bool stretchBorders = (m_frameSvg->hasElement(QStringLiteral("hint-stretch-borders")) //
                                    || m_frameSvg->hasElement(prefix % QLatin1String("hint-stretch-borders")));
-            FrameItemNode::FitMode borderFitMode = stretchBorders ? FrameItemNode::Stretch : FrameItemNode::Tile;
-            FrameItemNode::FitMode centerFitMode = tileCenter ? FrameItemNode::Tile : FrameItemNode::Stretch;
+            FrameNode::FitMode borderFitMode = stretchBorders ? FrameNode::Stretch : FrameNode::Tile;
+            FrameNode::FitMode centerFitMode = tileCenter ? FrameNode::Tile : FrameNode::Stretch;
 
-            new FrameItemNode(this, FrameSvg::NoBorder, centerFitMode, oldNode);
-            if (enabledBorders() & (FrameSvg::TopBorder | FrameSvg::LeftBorder)) {
-                new FrameItemNode(this, FrameSvg::TopBorder | FrameSvg::LeftBorder, FrameItemNode::FastStretch, oldNode);
-            }
-            if (enabledBorders() & (FrameSvg::TopBorder | FrameSvg::RightBorder)) {
-                new FrameItemNode(this, FrameSvg::TopBorder | FrameSvg::RightBorder, FrameItemNode::FastStretch, oldNode);
-            }
-            if (enabledBorders() & FrameSvg::TopBorder) {
-                new FrameItemNode(this, FrameSvg::TopBorder, borderFitMode, oldNode);
-            }
-            if (enabledBorders() & FrameSvg::BottomBorder) {
-                new FrameItemNode(this, FrameSvg::BottomBorder, borderFitMode, oldNode);
-            }
-            if (enabledBorders() & (FrameSvg::BottomBorder | FrameSvg::LeftBorder)) {
-                new FrameItemNode(this, FrameSvg::BottomBorder | FrameSvg::LeftBorder, FrameItemNode::FastStretch, oldNode);
-            }
-            if (enabledBorders() & (FrameSvg::BottomBorder | FrameSvg::RightBorder)) {
-                new FrameItemNode(this, FrameSvg::BottomBorder | FrameSvg::RightBorder, FrameItemNode::FastStretch, oldNode);
-            }
-            if (enabledBorders() & FrameSvg::LeftBorder) {
-                new FrameItemNode(this, FrameSvg::LeftBorder, borderFitMode, oldNode);
-            }
-            if (enabledBorders() & FrameSvg::RightBorder) {
-                new FrameItemNode(this, FrameSvg::RightBorder, borderFitMode, oldNode);
-            }
+            oldNode = new FrameNode(this, borderFitMode, centerFitMode);
 
             m_sizeChanged = true;
             m_textureChanged = false;
         }
 
-        QSGNode *node = oldNode->firstChild();
-        while (node) {
-            static_cast<FrameItemNode *>(node)->setFiltering(filtering);
-            node = node->nextSibling();
-        }
+        FrameNode *frameNode = static_cast<FrameNode *>(oldNode);
+        frameNode->setFiltering(filtering);
 
         if (m_sizeChanged) {
-            FrameNode *frameNode = static_cast<FrameNode *>(oldNode);
-            QSize frameSize(width(), height());
-            QRect geometry = frameNode->contentsRect(frameSize);
-            QSGNode *node = oldNode->firstChild();
-            while (node) {
-                static_cast<FrameItemNode *>(node)->reposition(geometry, frameSize);
-                node = node->nextSibling();
-            }
+            frameNode->reposition(QSize(width(), height()));
 
             m_sizeChanged = false;
         }
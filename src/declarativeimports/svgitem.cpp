@@ -8,6 +8,7 @@
 #include "svgitem.h"
 
 #include <QDebug>
+#include <QFuture>
 #include <QQuickWindow>
 #include <QRectF>
 #include <QSGTexture>
@@ -110,6 +111,21 @@ QSizeF SvgItem::naturalSize() const
     return m_svg->size();
 }
 
+void SvgItem::setAsynchronous(bool asynchronous)
+{
+    if (m_asynchronous == asynchronous) {
+        return;
+    }
+
+    m_asynchronous = asynchronous;
+    Q_EMIT asynchronousChanged();
+}
+
+bool SvgItem::isAsynchronous() const
+{
+    return m_asynchronous;
+}
+
 QSGNode *SvgItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *updatePaintNodeData)
 {
     Q_UNUSED(updatePaintNodeData);
@@ -134,7 +150,8 @@ QSGNode *SvgItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *updateP
     // if !m_smooth and size is approximate simply change the textureNode.rect without
     // updating the material
 
-    if (m_textureChanged || textureNode->texture()->textureSize() != QSize(width(), height())) {
+    // When asynchronous, an outdated texture gets stretched until the new image arrives
+    if (m_textureChanged || (!m_asynchronous && textureNode->texture()->textureSize() != QSize(width(), height()))) {
         // despite having a valid size sometimes we still get a null QImage from KSvg::Svg
         // loading a null texture to an atlas fatals
         // Dave E fixed this in Qt in 5.3.something onwards but we need this for now
@@ -147,6 +164,8 @@ QSGNode *SvgItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *updateP
         textureNode->setTexture(texture);
         m_textureChanged = false;
 
+        textureNode->setRect(0, 0, width(), height());
+    } else if (textureNode->rect() != QRectF(0, 0, width(), height())) {
         textureNode->setRect(0, 0, width(), height());
     }
 
@@ -178,12 +197,36 @@ void SvgItem::updatePolish()
 
     if (m_svg) {
         // setContainsMultipleImages has to be done there since m_svg can be shared with somebody else
-        m_textureChanged = true;
         m_svg->setContainsMultipleImages(!m_elementID.isEmpty());
-        m_image = m_svg->image(QSize(width(), height()), m_elementID);
+        const quint64 generation = ++m_imageGeneration;
+
+        if (!m_asynchronous) {
+            setImage(m_svg->image(QSize(width(), height()), m_elementID));
+            return;
+        }
+
+        QFuture<QImage> future = m_svg->imageAsync(QSize(width(), height()), m_elementID);
+        if (future.isFinished()) {
+            // Found in the cache
+            setImage(future.result());
+            return;
+        }
+
+        future.then(this, [this, generation](const QImage &image) {
+            if (generation == m_imageGeneration) {
+                setImage(image);
+                update();
+            }
+        });
     }
 }
 
+void SvgItem::setImage(const QImage &image)
+{
+    m_image = image;
+    m_textureChanged = true;
+}
+
 void SvgItem::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
 {
     if (newGeometry.size() != oldGeometry.size() && newGeometry.isValid()) {
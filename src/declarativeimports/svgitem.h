@@ -42,6 +42,12 @@ class SvgItem : public QQuickItem
      */
     Q_PROPERTY(QSizeF naturalSize READ naturalSize NOTIFY naturalSizeChanged)
 
+    /**
+     * If true, the svg is rendered in a separate thread: until the new image is ready,
+     * the previous one keeps being displayed, stretched to the item size. False by default.
+     */
+    Q_PROPERTY(bool asynchronous READ isAsynchronous WRITE setAsynchronous NOTIFY asynchronousChanged)
+
 public:
     /// @cond INTERNAL_DOCS
 
@@ -56,6 +62,9 @@ public:
 
     QSizeF naturalSize() const;
 
+    void setAsynchronous(bool asynchronous);
+    bool isAsynchronous() const;
+
     QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *updatePaintNodeData) override;
     /// @endcond
 
@@ -66,6 +75,7 @@ Q_SIGNALS:
     void imagePathChanged();
     void elementIdChanged();
     void naturalSizeChanged();
+    void asynchronousChanged();
 
 protected Q_SLOTS:
     /// @cond INTERNAL_DOCS
@@ -76,11 +86,15 @@ private:
     void scheduleImageUpdate();
     void updatePolish() override;
     void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    void setImage(const QImage &image);
 
     KSvg::Svg *m_svg;
     Kirigami::PlatformTheme *m_kirigamiTheme;
     QString m_elementID;
     bool m_textureChanged;
+    bool m_asynchronous = false;
+    // Incremented for every requested image, so that outdated asynchronous results are discarded
+    quint64 m_imageGeneration = 0;
     QImage m_image;
 };
 }
@@ -11,7 +11,6 @@
 #include <string>
 
 #include <QAtomicInt>
-#include <QBitmap>
 #include <QCryptographicHash>
 #include <QPainter>
 #include <QRegion>
@@ -25,11 +24,13 @@
 #include "imageset.h"
 #include "private/framesvg_helpers.h"
 #include "private/imageset_p.h"
+#include "private/maskbuilder_p.h"
 #include "private/svg_p.h"
 
 namespace KSvg
 {
-QHash<ImageSetPrivate *, QHash<uint, QWeakPointer<FrameData>>> FrameSvgPrivate::s_sharedFrames;
+QHash<ImageSetPrivate *, QHash<quint64, QWeakPointer<FrameData>>> FrameSvgPrivate::s_sharedFrames;
+QHash<ImageSetPrivate *, QHash<FrameMetricsKey, FrameMetrics>> FrameSvgPrivate::s_frameMetrics;
 
 // Any attempt to generate a frame whose width or height is larger than this
 // will be rejected
@@ -334,7 +335,7 @@ QRegion FrameSvg::mask() const
         return result;
     }
 
-    uint id = qHash(d->cacheId(d->frame.data(), QString()), SvgRectsCache::s_seed);
+    const quint64 id = d->cacheId(d->frame.data(), QString()).key();
 
     QRegion *obj = d->frame->cachedMasks.object(id);
 
@@ -347,7 +348,7 @@ QRegion FrameSvg::mask() const
             alphaMask = alphaMask.scaled(alphaMask.width() / dpr, alphaMask.height() / dpr);
         }
 
-        obj = new QRegion(QBitmap(alphaMask.mask()));
+        obj = new QRegion(MaskBuilder::regionFromAlpha(alphaMask.toImage()));
 
         result = *obj;
         d->frame->cachedMasks.insert(id, obj);
@@ -486,7 +487,7 @@ QPixmap FrameSvgPrivate::alphaMask()
 QSharedPointer<FrameData>
 FrameSvgPrivate::lookupOrCreateMaskFrame(const QSharedPointer<FrameData> &frame, const QString &maskPrefix, const QString &maskRequestedPrefix)
 {
-    const uint key = qHash(cacheId(frame.data(), maskPrefix));
+    const quint64 key = cacheId(frame.data(), maskPrefix).key();
     QSharedPointer<FrameData> mask = s_sharedFrames[q->imageSet()->d].value(key);
 
     // See if we can find a suitable candidate in the shared frames.
@@ -515,7 +516,7 @@ void FrameSvgPrivate::generateBackground(const QSharedPointer<FrameData> &frame)
         return;
     }
 
-    const uint id = qHash(cacheId(frame.data(), frame->prefix));
+    const QString id = cacheId(frame.data(), frame->prefix).pixmapKey();
 
     bool frameCached = !frame->cachedBackground.isNull();
     bool overlayCached = false;
@@ -523,11 +524,11 @@ void FrameSvgPrivate::generateBackground(const QSharedPointer<FrameData> &frame)
     const bool overlayAvailable = !frame->prefix.startsWith(QLatin1String("mask-")) && q->hasElement(frame->prefix % QLatin1String("overlay"));
     QPixmap overlay;
     if (q->isUsingRenderingCache()) {
-        frameCached = q->imageSet()->d->findInCache(QString::number(id), frame->cachedBackground, frame->lastModified) && !frame->cachedBackground.isNull();
+        frameCached = q->imageSet()->d->findInCache(id, frame->cachedBackground, frame->lastModified) && !frame->cachedBackground.isNull();
 
         if (overlayAvailable) {
-            const uint overlayId = qHash(cacheId(frame.data(), frame->prefix % QLatin1String("overlay")));
-            overlayCached = q->imageSet()->d->findInCache(QString::number(overlayId), overlay, frame->lastModified) && !overlay.isNull();
+            const QString overlayId = cacheId(frame.data(), frame->prefix % QLatin1String("overlay")).pixmapKey();
+            overlayCached = q->imageSet()->d->findInCache(overlayId, overlay, frame->lastModified) && !overlay.isNull();
         }
     }
 
@@ -647,10 +648,10 @@ QRect FrameSvgPrivate::contentGeometry(const QSharedPointer<FrameData> &frame, c
 void FrameSvgPrivate::updateFrameData(uint lastModified, UpdateType updateType)
 {
     auto fd = frame;
-    uint newKey = 0;
+    quint64 newKey = 0;
 
     if (fd) {
-        const uint oldKey = fd->cacheId;
+        const quint64 oldKey = fd->cacheId;
 
         const QString oldPath = fd->imagePath;
         const FrameSvg::EnabledBorders oldBorders = fd->enabledBorders;
@@ -660,7 +661,7 @@ void FrameSvgPrivate::updateFrameData(uint lastModified, UpdateType updateType)
         fd->frameSize = pendingFrameSize;
         fd->imagePath = q->imagePath();
 
-        newKey = qHash(cacheId(fd.data(), prefix));
+        newKey = cacheId(fd.data(), prefix).key();
 
         // reset frame to old values
         fd->enabledBorders = oldBorders;
@@ -697,7 +698,7 @@ void FrameSvgPrivate::updateFrameData(uint lastModified, UpdateType updateType)
     fd->lastModified = lastModified;
     // was fd just created empty now?
     if (newKey == 0) {
-        newKey = qHash(cacheId(fd.data(), prefix));
+        newKey = cacheId(fd.data(), prefix).key();
     }
 
     // we know it isn't in s_sharedFrames due to the check above, so insert it now
@@ -716,13 +717,7 @@ void FrameSvgPrivate::paintCenter(QPainter &p, const QSharedPointer<FrameData> &
     if (!contentRect.isEmpty()) {
         const QString centerElementId = frame->prefix % QLatin1String("center");
         if (frame->tileCenter) {
-            QSize centerTileSize = q->elementSize(centerElementId);
-            QPixmap center(centerTileSize);
-            center.fill(Qt::transparent);
-
-            QPainter centerPainter(&center);
-            centerPainter.setCompositionMode(QPainter::CompositionMode_Source);
-            q->paint(&centerPainter, QRect(QPoint(0, 0), centerTileSize), centerElementId);
+            const QPixmap center = frameSlice(centerElementId, q->elementSize(centerElementId));
 
             if (frame->composeOverBorder) {
                 p.drawTiledPixmap(QRect(QPoint(0, 0), fullSize), center);
@@ -756,14 +751,7 @@ void FrameSvgPrivate::paintBorder(QPainter &p,
         if (frame->stretchBorders) {
             q->paint(&p, FrameSvgHelpers::sectionRect(borders, contentRect, frame->frameSize), side);
         } else {
-            QPixmap px(size);
-            px.fill(Qt::transparent);
-
-            QPainter sidePainter(&px);
-            sidePainter.setCompositionMode(QPainter::CompositionMode_Source);
-            q->paint(&sidePainter, QRect(QPoint(0, 0), size), side);
-
-            p.drawTiledPixmap(FrameSvgHelpers::sectionRect(borders, contentRect, frame->frameSize), px);
+            p.drawTiledPixmap(FrameSvgHelpers::sectionRect(borders, contentRect, frame->frameSize), frameSlice(side, size));
         }
     }
 }
@@ -776,21 +764,61 @@ void FrameSvgPrivate::paintCorner(QPainter &p, const QSharedPointer<FrameData> &
     }
     const QString corner = frame->prefix % FrameSvgHelpers::borderToElementId(border);
     if (q->hasElement(corner)) {
-        q->paint(&p, FrameSvgHelpers::sectionRect(border, contentRect, frame->frameSize), corner);
+        const QRect cornerRect = FrameSvgHelpers::sectionRect(border, contentRect, frame->frameSize);
+        if (!cornerRect.isEmpty()) {
+            p.drawPixmap(cornerRect, frameSlice(corner, cornerRect.size()));
+        }
     }
 }
 
+QPixmap FrameSvgPrivate::frameSlice(const QString &elementId, const QSize &size) const
+{
+    // Corners and tiles don't depend on the frame size: render them once and only compose them for new sizes
+    const SvgPrivate::CacheId sliceId(double(size.width()),
+                                      double(size.height()),
+                                      q->Svg::d->pathAtom(),
+                                      SvgAtom::intern(elementId),
+                                      q->status(),
+                                      q->scaleFactor(),
+                                      qint64(q->Svg::d->paletteId(q->palette(),
+                                                                  q->extraColor(Svg::Positive),
+                                                                  q->extraColor(Svg::Neutral),
+                                                                  q->extraColor(Svg::Negative))),
+                                      0,
+                                      q->Svg::d->lastModified);
+    const quint64 key = sliceId.key();
+
+    QCache<quint64, QPixmap> &slices = q->imageSet()->d->frameSlices;
+    if (const QPixmap *slice = slices.object(key)) {
+        return *slice;
+    }
+
+    QPixmap slice(size);
+    slice.fill(Qt::transparent);
+
+    QPainter slicePainter(&slice);
+    slicePainter.setCompositionMode(QPainter::CompositionMode_Source);
+    q->paint(&slicePainter, QRect(QPoint(0, 0), size), elementId);
+    slicePainter.end();
+
+    // The cost is in KiB
+    slices.insert(key, new QPixmap(slice), std::max<qsizetype>(1, qsizetype(size.width()) * size.height() * 4 / 1024));
+    q->imageSet()->d->updateMemoryStatistics();
+    return slice;
+}
+
 SvgPrivate::CacheId FrameSvgPrivate::cacheId(FrameData *frame, const QString &prefixToSave) const
 {
     const QSize size = frameSize(frame).toSize();
-    return SvgPrivate::CacheId{double(size.width()),
+    return SvgPrivate::CacheId(double(size.width()),
                                double(size.height()),
-                               frame->imagePath,
-                               prefixToSave,
+                               SvgAtom::intern(frame->imagePath),
+                               SvgAtom::intern(prefixToSave),
                                q->status(),
                                q->scaleFactor(),
+                               -1,
                                (uint)frame->enabledBorders,
-                               q->Svg::d->lastModified};
+                               q->Svg::d->lastModified);
 }
 
 void FrameSvgPrivate::cacheFrame(const QString &prefixToSave, const QPixmap &background, const QPixmap &overlay)
@@ -804,29 +832,34 @@ void FrameSvgPrivate::cacheFrame(const QString &prefixToSave, const QPixmap &bac
         return;
     }
 
-    const uint id = qHash(cacheId(frame.data(), prefixToSave));
+    const QString id = cacheId(frame.data(), prefixToSave).pixmapKey();
 
     // qCDebug(LOG_KSVG)<<"Saving to cache frame"<<id;
 
-    q->imageSet()->d->insertIntoCache(QString::number(id), background, QString::number((qint64)q, 16) % prefixToSave);
+    q->imageSet()->d->insertIntoCache(id, background, QString::number((qint64)q, 16) % prefixToSave);
 
     if (!overlay.isNull()) {
         // insert overlay
-        const uint overlayId = qHash(cacheId(frame.data(), frame->prefix % QLatin1String("overlay")));
-        q->imageSet()->d->insertIntoCache(QString::number(overlayId), overlay, QString::number((qint64)q, 16) % prefixToSave % QLatin1String("overlay"));
+        const QString overlayId = cacheId(frame.data(), frame->prefix % QLatin1String("overlay")).pixmapKey();
+        q->imageSet()->d->insertIntoCache(overlayId, overlay, QString::number((qint64)q, 16) % prefixToSave % QLatin1String("overlay"));
     }
 }
 
-void FrameSvgPrivate::updateSizes(FrameData *frame) const
+FrameMetrics FrameSvgPrivate::frameMetrics(FrameData *frame) const
 {
-    // qCDebug(LOG_KSVG) << "!!!!!!!!!!!!!!!!!!!!!! updating sizes" << prefix;
-    Q_ASSERT(frame);
+    // None of those depend on the frame size, nor on which borders are enabled
+    FrameMetricsKey key{q->Svg::d->path, frame->prefix, q->scaleFactor(), q->Svg::d->lastModified};
+    QHash<FrameMetricsKey, FrameMetrics> &metricsCache = s_frameMetrics[q->imageSet()->d];
+
+    if (!key.path.isEmpty()) {
+        auto it = metricsCache.constFind(key);
+        if (it != metricsCache.constEnd()) {
+            return *it;
+        }
+    }
 
     QSize s = q->size();
     q->resize();
-    if (!frame->cachedBackground.isNull()) {
-        frame->cachedBackground = QPixmap();
-    }
 
     // This function needs to do a lot of string creation, since we have four
     // sides with matching margins and insets. Rather than creating a new string
@@ -847,90 +880,62 @@ void FrameSvgPrivate::updateSizes(FrameData *frame) const
         return QStringView(nameBuffer).mid(0, offset + length - 1);
     };
 
-    // This has the same size regardless the border is enabled or not
-    frame->fixedTopHeight = q->elementSize(createName(u"top")).height();
+    FrameMetrics metrics;
 
-    if (auto topMargin = q->elementRect(createName(u"hint-top-margin")); topMargin.isValid()) {
-        frame->fixedTopMargin = topMargin.height();
-    } else {
-        frame->fixedTopMargin = frame->fixedTopHeight;
-    }
+    metrics.fixedTopHeight = q->elementSize(createName(u"top")).height();
 
-    // The same, but its size depends from the margin being enabled
-    if (frame->enabledBorders & FrameSvg::TopBorder) {
-        frame->topMargin = frame->fixedTopMargin;
-        frame->topHeight = frame->fixedTopHeight;
+    if (auto topMargin = q->elementRect(createName(u"hint-top-margin")); topMargin.isValid()) {
+        metrics.fixedTopMargin = topMargin.height();
     } else {
-        frame->topMargin = frame->topHeight = 0;
+        metrics.fixedTopMargin = metrics.fixedTopHeight;
     }
 
     if (auto topInset = q->elementRect(createName(u"hint-top-inset")); topInset.isValid()) {
-        frame->insetTopMargin = topInset.height();
+        metrics.insetTopMargin = topInset.height();
     } else {
-        frame->insetTopMargin = -1;
+        metrics.insetTopMargin = -1;
     }
 
-    frame->fixedLeftWidth = q->elementSize(createName(u"left")).width();
+    metrics.fixedLeftWidth = q->elementSize(createName(u"left")).width();
 
     if (auto leftMargin = q->elementRect(createName(u"hint-left-margin")); leftMargin.isValid()) {
-        frame->fixedLeftMargin = leftMargin.width();
-    } else {
-        frame->fixedLeftMargin = frame->fixedLeftWidth;
-    }
-
-    if (frame->enabledBorders & FrameSvg::LeftBorder) {
-        frame->leftMargin = frame->fixedLeftMargin;
-        frame->leftWidth = frame->fixedLeftWidth;
+        metrics.fixedLeftMargin = leftMargin.width();
     } else {
-        frame->leftMargin = frame->leftWidth = 0;
+        metrics.fixedLeftMargin = metrics.fixedLeftWidth;
     }
 
     if (auto leftInset = q->elementRect(createName(u"hint-left-inset")); leftInset.isValid()) {
-        frame->insetLeftMargin = leftInset.width();
+        metrics.insetLeftMargin = leftInset.width();
     } else {
-        frame->insetLeftMargin = -1;
+        metrics.insetLeftMargin = -1;
     }
 
-    frame->fixedRightWidth = q->elementSize(createName(u"right")).width();
+    metrics.fixedRightWidth = q->elementSize(createName(u"right")).width();
 
     if (auto rightMargin = q->elementRect(createName(u"hint-right-margin")); rightMargin.isValid()) {
-        frame->fixedRightMargin = rightMargin.width();
+        metrics.fixedRightMargin = rightMargin.width();
     } else {
-        frame->fixedRightMargin = frame->fixedRightWidth;
-    }
-
-    if (frame->enabledBorders & FrameSvg::RightBorder) {
-        frame->rightMargin = frame->fixedRightMargin;
-        frame->rightWidth = frame->fixedRightWidth;
-    } else {
-        frame->rightMargin = frame->rightWidth = 0;
+        metrics.fixedRightMargin = metrics.fixedRightWidth;
     }
 
     if (auto rightInset = q->elementRect(createName(u"hint-right-inset")); rightInset.isValid()) {
-        frame->insetRightMargin = rightInset.width();
+        metrics.insetRightMargin = rightInset.width();
     } else {
-        frame->insetRightMargin = -1;
+        metrics.insetRightMargin = -1;
     }
 
-    frame->fixedBottomHeight = q->elementSize(createName(u"bottom")).height();
+    metrics.fixedBottomHeight = q->elementSize(createName(u"bottom")).height();
 
     if (auto bottomMargin = q->elementRect(createName(u"hint-bottom-margin")); bottomMargin.isValid()) {
-        frame->fixedBottomMargin = bottomMargin.height();
+        metrics.fixedBottomMargin = bottomMargin.height();
     } else {
-        frame->fixedBottomMargin = frame->fixedBottomHeight;
-    }
-
-    if (frame->enabledBorders & FrameSvg::BottomBorder) {
-        frame->bottomMargin = frame->fixedBottomMargin;
-        frame->bottomHeight = frame->fixedBottomHeight;
-    } else {
-        frame->bottomMargin = frame->bottomHeight = 0;
+        metrics.fixedBottomMargin = metrics.fixedBottomHeight;
     }
 
     if (auto bottomInset = q->elementRect(createName(u"hint-bottom-inset")); bottomInset.isValid()) {
-        frame->insetBottomMargin = bottomInset.height();
+        metrics.insetBottomMargin = bottomInset.height();
     } else {
-        frame->insetBottomMargin = -1;
+        metrics.insetBottomMargin = -1;
     }
 
     static const QString maskPrefix = QStringLiteral("mask-");
@@ -938,14 +943,82 @@ void FrameSvgPrivate::updateSizes(FrameData *frame) const
     static const QString hintNoBorderPadding = QStringLiteral("hint-no-border-padding");
     static const QString hintStretchBorders = QStringLiteral("hint-stretch-borders");
 
-    frame->composeOverBorder = (q->hasElement(createName(u"hint-compose-over-border")) && q->hasElement(maskPrefix % createName(u"center")));
+    metrics.composeOverBorder = (q->hasElement(createName(u"hint-compose-over-border")) && q->hasElement(maskPrefix % createName(u"center")));
 
     // since it's rectangular, topWidth and bottomWidth must be the same
     // the ones that don't have a frame->prefix is for retrocompatibility
-    frame->tileCenter = (q->hasElement(hintTileCenter) || q->hasElement(createName(u"hint-tile-center")));
-    frame->noBorderPadding = (q->hasElement(hintNoBorderPadding) || q->hasElement(createName(u"hint-no-border-padding")));
-    frame->stretchBorders = (q->hasElement(hintStretchBorders) || q->hasElement(createName(u"hint-stretch-borders")));
+    metrics.tileCenter = (q->hasElement(hintTileCenter) || q->hasElement(createName(u"hint-tile-center")));
+    metrics.noBorderPadding = (q->hasElement(hintNoBorderPadding) || q->hasElement(createName(u"hint-no-border-padding")));
+    metrics.stretchBorders = (q->hasElement(hintStretchBorders) || q->hasElement(createName(u"hint-stretch-borders")));
     q->resize(s);
+
+    // themed images get their path resolved by the first element lookup
+    key.path = q->Svg::d->path;
+    key.lastModified = q->Svg::d->lastModified;
+    if (!key.path.isEmpty()) {
+        metricsCache.insert(key, metrics);
+    }
+
+    return metrics;
+}
+
+void FrameSvgPrivate::updateSizes(FrameData *frame) const
+{
+    // qCDebug(LOG_KSVG) << "!!!!!!!!!!!!!!!!!!!!!! updating sizes" << prefix;
+    Q_ASSERT(frame);
+
+    if (!frame->cachedBackground.isNull()) {
+        frame->cachedBackground = QPixmap();
+    }
+
+    const FrameMetrics metrics = frameMetrics(frame);
+
+    // This has the same size regardless the border is enabled or not
+    frame->fixedTopHeight = metrics.fixedTopHeight;
+    frame->fixedTopMargin = metrics.fixedTopMargin;
+    frame->insetTopMargin = metrics.insetTopMargin;
+    // The same, but its size depends from the margin being enabled
+    if (frame->enabledBorders & FrameSvg::TopBorder) {
+        frame->topMargin = frame->fixedTopMargin;
+        frame->topHeight = frame->fixedTopHeight;
+    } else {
+        frame->topMargin = frame->topHeight = 0;
+    }
+
+    frame->fixedLeftWidth = metrics.fixedLeftWidth;
+    frame->fixedLeftMargin = metrics.fixedLeftMargin;
+    frame->insetLeftMargin = metrics.insetLeftMargin;
+    if (frame->enabledBorders & FrameSvg::LeftBorder) {
+        frame->leftMargin = frame->fixedLeftMargin;
+        frame->leftWidth = frame->fixedLeftWidth;
+    } else {
+        frame->leftMargin = frame->leftWidth = 0;
+    }
+
+    frame->fixedRightWidth = metrics.fixedRightWidth;
+    frame->fixedRightMargin = metrics.fixedRightMargin;
+    frame->insetRightMargin = metrics.insetRightMargin;
+    if (frame->enabledBorders & FrameSvg::RightBorder) {
+        frame->rightMargin = frame->fixedRightMargin;
+        frame->rightWidth = frame->fixedRightWidth;
+    } else {
+        frame->rightMargin = frame->rightWidth = 0;
+    }
+
+    frame->fixedBottomHeight = metrics.fixedBottomHeight;
+    frame->fixedBottomMargin = metrics.fixedBottomMargin;
+    frame->insetBottomMargin = metrics.insetBottomMargin;
+    if (frame->enabledBorders & FrameSvg::BottomBorder) {
+        frame->bottomMargin = frame->fixedBottomMargin;
+        frame->bottomHeight = frame->fixedBottomHeight;
+    } else {
+        frame->bottomMargin = frame->bottomHeight = 0;
+    }
+
+    frame->composeOverBorder = metrics.composeOverBorder;
+    frame->tileCenter = metrics.tileCenter;
+    frame->noBorderPadding = metrics.noBorderPadding;
+    frame->stretchBorders = metrics.stretchBorders;
 }
 
 void FrameSvgPrivate::updateNeeded()
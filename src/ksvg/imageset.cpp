@@ -232,8 +232,7 @@ bool ImageSet::useGlobalSettings() const
 void ImageSet::setCacheLimit(int kbytes)
 {
     d->cacheSize = kbytes;
-    delete d->pixmapCache;
-    d->pixmapCache = nullptr;
+    d->resetPixmapCache();
 }
 
 KPluginMetaData ImageSet::metadata() const
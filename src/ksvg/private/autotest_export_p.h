@@ -0,0 +1,19 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KSVG_AUTOTEST_EXPORT_P_H
+#define KSVG_AUTOTEST_EXPORT_P_H
+
+#include <ksvg/ksvg_export.h>
+
+// Exports private classes only when building the tests, so that they can be benchmarked directly
+#ifdef KSVG_BUILD_TESTING
+#define KSVG_AUTOTEST_EXPORT KSVG_EXPORT
+#else
+#define KSVG_AUTOTEST_EXPORT
+#endif
+
+#endif
@@ -20,6 +20,46 @@
 
 namespace KSvg
 {
+// Measures of a frame which depend neither on its size nor on its enabled borders
+struct FrameMetrics {
+    int fixedTopHeight = 0;
+    int fixedLeftWidth = 0;
+    int fixedRightWidth = 0;
+    int fixedBottomHeight = 0;
+
+    int fixedTopMargin = 0;
+    int fixedLeftMargin = 0;
+    int fixedRightMargin = 0;
+    int fixedBottomMargin = 0;
+
+    int insetTopMargin = -1;
+    int insetLeftMargin = -1;
+    int insetRightMargin = -1;
+    int insetBottomMargin = -1;
+
+    bool noBorderPadding = false;
+    bool stretchBorders = false;
+    bool tileCenter = false;
+    bool composeOverBorder = false;
+};
+
+struct FrameMetricsKey {
+    QString path;
+    QString prefix;
+    qreal scaleFactor;
+    uint lastModified;
+
+    bool operator==(const FrameMetricsKey &other) const
+    {
+        return path == other.path && prefix == other.prefix && scaleFactor == other.scaleFactor && lastModified == other.lastModified;
+    }
+};
+
+inline size_t qHash(const FrameMetricsKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.path, key.prefix, key.scaleFactor, key.lastModified);
+}
+
 class FrameData
 {
 public:
@@ -73,12 +113,12 @@ public:
     QString requestedPrefix;
     FrameSvg::EnabledBorders enabledBorders;
     QPixmap cachedBackground;
-    QCache<uint, QRegion> cachedMasks;
+    QCache<quint64, QRegion> cachedMasks;
     static const int MAX_CACHED_MASKS = 10;
     uint lastModified = 0;
 
     QSize frameSize;
-    uint cacheId;
+    quint64 cacheId;
 
     // measures
     int topHeight;
@@ -145,6 +185,7 @@ public:
     void generateFrameBackground(const QSharedPointer<FrameData> &);
     SvgPrivate::CacheId cacheId(FrameData *frame, const QString &prefixToUse) const;
     void cacheFrame(const QString &prefixToSave, const QPixmap &background, const QPixmap &overlay);
+    FrameMetrics frameMetrics(FrameData *frame) const;
     void updateSizes(FrameData *frame) const;
     void updateSizes(const QSharedPointer<FrameData> &frame) const
     {
@@ -163,6 +204,7 @@ public:
                      const QSize &originalSize,
                      const QRect &output) const;
     void paintCorner(QPainter &p, const QSharedPointer<FrameData> &frame, KSvg::FrameSvg::EnabledBorders border, const QRect &output) const;
+    QPixmap frameSlice(const QString &elementId, const QSize &size) const;
     void paintCenter(QPainter &p, const QSharedPointer<FrameData> &frame, const QRect &contentRect, const QSize &fullSize);
     QRect contentGeometry(const QSharedPointer<FrameData> &frame, const QSize &size) const;
     void updateFrameData(uint lastModified, UpdateType updateType = UpdateFrameAndMargins);
@@ -186,7 +228,8 @@ public:
     // this can differ from frame->frameSize if we are in a transition
     QSize pendingFrameSize;
 
-    static QHash<ImageSetPrivate *, QHash<uint, QWeakPointer<FrameData>>> s_sharedFrames;
+    static QHash<ImageSetPrivate *, QHash<quint64, QWeakPointer<FrameData>>> s_sharedFrames;
+    static QHash<ImageSetPrivate *, QHash<FrameMetricsKey, FrameMetrics>> s_frameMetrics;
 
     bool cacheAll : 1;
     bool repaintBlocked : 1;
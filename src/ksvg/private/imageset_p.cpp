@@ -9,22 +9,44 @@
 #include "debug_p.h"
 #include "framesvg.h"
 #include "framesvg_p.h"
+#include "pixmapcachewriter_p.h"
+#include "statistics_p.h"
 #include "svg_p.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QFontDatabase>
 #include <QGuiApplication>
+#include <QImage>
 
 #include <KDirWatch>
 #include <KSharedConfig>
 #include <kpluginmetadata.h>
 
 #define DEFAULT_CACHE_SIZE 16384 // value is from the old kconfigxt default value
+#define FRAME_SLICES_CACHE_SIZE 8192 // in KiB
+#define RECENT_PIXMAPS_CACHE_SIZE 16384 // in KiB
 
 namespace KSvg
 {
+// Header of the pixmaps stored as RawPixmaps, followed by their rows
+struct RawPixmapHeader {
+    char magic[4];
+    quint32 reserved; // Always 0
+    qint32 width;
+    qint32 height;
+    qint32 bytesPerLine;
+    quint32 padding;
+    double devicePixelRatio;
+};
+
+static const char s_rawPixmapMagic[4] = {'K', 'S', 'R', 'P'};
+
 const char ImageSetPrivate::defaultImageSet[] = "default";
 // the system colors theme is used to cache unthemed svgs with colorization needs
 // these svgs do not follow the theme's colors, but rather the system colors
@@ -64,6 +86,8 @@ KPluginMetaData metaDataForImageSet(const QString &basePath, const QString &them
 ImageSetPrivate::ImageSetPrivate(QObject *parent)
     : QObject(parent)
     , pixmapCache(nullptr)
+    , frameSlices(FRAME_SLICES_CACHE_SIZE)
+    , recentPixmaps(RECENT_PIXMAPS_CACHE_SIZE)
     , cacheSize(DEFAULT_CACHE_SIZE)
     , cachesToDiscard(NoCache)
     , isDefault(true)
@@ -101,13 +125,21 @@ ImageSetPrivate::ImageSetPrivate(QObject *parent)
     updateNotificationTimer->setInterval(100);
     QObject::connect(updateNotificationTimer, &QTimer::timeout, this, &ImageSetPrivate::notifyOfChanged);
 
+    QObject::connect(SvgRectsCache::instance(), &SvgRectsCache::lastModifiedChanged, this, &ImageSetPrivate::discardFile);
+
     QCoreApplication::instance()->installEventFilter(this);
 }
 
 ImageSetPrivate::~ImageSetPrivate()
 {
     FrameSvgPrivate::s_sharedFrames.remove(this);
-    delete pixmapCache;
+    FrameSvgPrivate::s_frameMetrics.remove(this);
+    resetPixmapCache();
+    clearQueuedPixmaps();
+    frameSlices.clear();
+    recentPixmaps.clear();
+    updateMemoryStatistics();
+    updatePixmapCacheStatistics();
 }
 
 bool ImageSetPrivate::useCache()
@@ -119,7 +151,8 @@ bool ImageSetPrivate::useCache()
             cacheSize = DEFAULT_CACHE_SIZE;
         }
         const bool isRegularImageSet = imageSetName != QLatin1String(systemColorsImageSet);
-        QString cacheFile = QLatin1String("plasma_theme_") + imageSetName;
+        // Raw pixmaps go in their own cache, which processes storing encoded pixmaps can't read
+        QString cacheFile = (pixmapStorage() == EncodedPixmaps ? QLatin1String("plasma_theme_") : QLatin1String("ksvg_raw_theme_")) + imageSetName;
 
         // clear any cached values from the previous theme cache
         themeVersion.clear();
@@ -192,18 +225,49 @@ bool ImageSetPrivate::useCache()
 
 void ImageSetPrivate::onAppExitCleanup()
 {
-    pixmapsToCache.clear();
-    delete pixmapCache;
-    pixmapCache = nullptr;
+    clearQueuedPixmaps();
+    resetPixmapCache();
     cacheImageSet = false;
+    updateMemoryStatistics();
+    updatePixmapCacheStatistics();
 }
 
 QString ImageSetPrivate::imagePath(const QString &theme, const QString &type, const QString &image)
 {
+    if (image.endsWith(QLatin1String(".svgz")) || image.endsWith(QLatin1String(".svg"))) {
+        if (const ThemeBundle::Ptr bundle = themeBundle(theme)) {
+            // The bundle usually has all the svgs of the theme
+            const QString relativePath = type.mid(1) + image;
+            if (bundle->findImage(relativePath)) {
+                return bundle->directory() % type % image;
+            }
+            // Not compiled in, for instance added after the bundle
+        }
+    }
+
     QString subdir = basePath % theme % type % image;
     return QStandardPaths::locate(QStandardPaths::GenericDataLocation, subdir);
 }
 
+ThemeBundle::Ptr ImageSetPrivate::themeBundle(const QString &theme)
+{
+    auto it = themeBundles.constFind(theme);
+    if (it != themeBundles.constEnd()) {
+        return it.value();
+    }
+
+    // A bundle only covers its own directory: when the theme is split among several
+    // directories, for instance with local overrides, it has to be resolved file by file
+    ThemeBundle::Ptr bundle;
+    const QStringList directories = QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, basePath % theme, QStandardPaths::LocateDirectory);
+    if (directories.size() == 1) {
+        bundle = ThemeBundle::open(directories.first());
+    }
+
+    themeBundles.insert(theme, bundle);
+    return bundle;
+}
+
 QString ImageSetPrivate::findInImageSet(const QString &image, const QString &theme, bool cache)
 {
     if (cache) {
@@ -239,23 +303,45 @@ QString ImageSetPrivate::findInImageSet(const QString &image, const QString &the
 void ImageSetPrivate::discardCache(CacheTypes caches)
 {
     if (caches & PixmapCache) {
-        pixmapsToCache.clear();
+        clearQueuedPixmaps();
         pixmapSaveTimer->stop();
         if (pixmapCache) {
+            // Writes still queued would land after the clear
+            if (PixmapCacheWriter *writer = PixmapCacheWriter::instance()) {
+                writer->flush();
+            }
+            QMutexLocker locker(PixmapCacheWriter::cacheMutex());
             pixmapCache->clear();
         }
     } else {
         // This deletes the object but keeps the on-disk cache for later use
-        delete pixmapCache;
-        pixmapCache = nullptr;
+        resetPixmapCache();
     }
 
+    frameSlices.clear();
+    recentPixmaps.clear();
     cachedSvgStyleSheets.clear();
-    cachedSelectedSvgStyleSheets.clear();
-    cachedInactiveSvgStyleSheets.clear();
+    // Keyed by theme file and scale factor: those of the previous theme are never found again
+    FrameSvgPrivate::s_frameMetrics.remove(this);
 
     if (caches & SvgElementsCache) {
         discoveries.clear();
+        themeBundles.clear();
+    }
+
+    updateMemoryStatistics();
+    updatePixmapCacheStatistics();
+}
+
+void ImageSetPrivate::discardFile(const QString &path)
+{
+    // The other caches are keyed by the modification time of the file as well, but not by its path:
+    // their entries for the previous content are never found again and are the first to be evicted
+    auto it = FrameSvgPrivate::s_frameMetrics.find(this);
+    if (it != FrameSvgPrivate::s_frameMetrics.end()) {
+        it->removeIf([&path](const QHash<FrameMetricsKey, FrameMetrics>::iterator metrics) {
+            return metrics.key().path == path;
+        });
     }
 }
 
@@ -265,13 +351,81 @@ void ImageSetPrivate::scheduledCacheUpdate()
         QHashIterator<QString, QPixmap> it(pixmapsToCache);
         while (it.hasNext()) {
             it.next();
-            pixmapCache->insertPixmap(idsToCache[it.key()], it.value());
+            const QString key = idsToCache[it.key()];
+            writePixmap(key, it.value());
+            cacheRecentPixmap(key, it.value());
+            StatisticsPrivate::increment(Statistics::PixmapCacheInserts);
         }
     }
 
-    pixmapsToCache.clear();
+    clearQueuedPixmaps();
     keysToCache.clear();
     idsToCache.clear();
+
+    updateMemoryStatistics();
+    updatePixmapCacheStatistics();
+}
+
+void ImageSetPrivate::updateMemoryStatistics()
+{
+    // The cost of the frame slices and recent pixmaps is in KiB
+    const qint64 frameSliceBytes = qint64(frameSlices.totalCost()) * 1024;
+    const qint64 recentPixmapBytes = qint64(recentPixmaps.totalCost()) * 1024;
+
+    StatisticsPrivate::adjustGauge(Statistics::PendingPixmapBytes, pendingPixmapBytes - reportedPendingPixmapBytes);
+    StatisticsPrivate::adjustGauge(Statistics::FrameSliceBytes, frameSliceBytes - reportedFrameSliceBytes);
+    StatisticsPrivate::adjustGauge(Statistics::RecentPixmapBytes, recentPixmapBytes - reportedRecentPixmapBytes);
+    reportedPendingPixmapBytes = pendingPixmapBytes;
+    reportedFrameSliceBytes = frameSliceBytes;
+    reportedRecentPixmapBytes = recentPixmapBytes;
+}
+
+void ImageSetPrivate::updatePixmapCacheStatistics()
+{
+    if (!StatisticsPrivate::enabled()) {
+        return;
+    }
+
+    qint64 pixmapCacheBytes = 0;
+    if (pixmapCache) {
+        QMutexLocker locker(PixmapCacheWriter::cacheMutex());
+        pixmapCacheBytes = qint64(pixmapCache->totalSize()) - qint64(pixmapCache->freeSize());
+    }
+    StatisticsPrivate::adjustGauge(Statistics::PixmapCacheBytes, pixmapCacheBytes - reportedPixmapCacheBytes);
+    reportedPixmapCacheBytes = pixmapCacheBytes;
+}
+
+static qint64 pixmapBytes(const QPixmap &pix)
+{
+    return qint64(pix.width()) * pix.height() * pix.depth() / 8;
+}
+
+void ImageSetPrivate::queuePixmap(const QString &id, const QPixmap &pix)
+{
+    auto it = pixmapsToCache.find(id);
+    if (it != pixmapsToCache.end()) {
+        pendingPixmapBytes -= pixmapBytes(*it);
+        *it = pix;
+    } else {
+        pixmapsToCache.insert(id, pix);
+    }
+    pendingPixmapBytes += pixmapBytes(pix);
+}
+
+void ImageSetPrivate::clearQueuedPixmaps()
+{
+    pixmapsToCache.clear();
+    pendingPixmapBytes = 0;
+}
+
+void ImageSetPrivate::cacheRecentPixmap(const QString &key, const QPixmap &pix)
+{
+    if (pix.isNull()) {
+        return;
+    }
+
+    const qsizetype cost = std::max<qsizetype>(1, qsizetype(pix.width()) * pix.height() * pix.depth() / 8 / 1024);
+    recentPixmaps.insert(key, new QPixmap(pix), cost);
 }
 
 void ImageSetPrivate::scheduleImageSetChangeNotification(CacheTypes caches)
@@ -288,15 +442,89 @@ void ImageSetPrivate::notifyOfChanged()
     Q_EMIT imageSetChanged();
 }
 
-const QString ImageSetPrivate::processStyleSheet(const QString &css,
-                                                 KSvg::Svg::Status status,
-                                                 const QPalette &palette,
-                                                 const QColor &positive,
-                                                 const QColor &neutral,
-                                                 const QColor &negative)
+namespace
 {
-    QString stylesheet(css);
+enum StyleSheetPlaceholder {
+    TextColor = 0,
+    BackgroundColor,
+    HighlightColor,
+    HighlightedTextColor,
+    VisitedLink,
+    ActivatedLink,
+    HoveredLink,
+    Link,
+    PositiveTextColor,
+    NeutralTextColor,
+    NegativeTextColor,
+    FontSize,
+    FontFamily,
+    SmallFontSize,
+    PlaceholderCount,
+};
+
+struct StyleSheetPlaceholderName {
+    QLatin1StringView name;
+    StyleSheetPlaceholder placeholder;
+};
+
+// If you add placeholders here, make sure their names are sufficiently unique to not cause
+// clashes between them: none may start with the whole name of another
+const StyleSheetPlaceholderName s_styleSheetPlaceholders[] = {
+    {QLatin1StringView("%textcolor"), TextColor},
+    {QLatin1StringView("%backgroundcolor"), BackgroundColor},
+    {QLatin1StringView("%highlightcolor"), HighlightColor},
+    {QLatin1StringView("%highlightedtextcolor"), HighlightedTextColor},
+    {QLatin1StringView("%visitedlink"), VisitedLink},
+    {QLatin1StringView("%activatedlink"), ActivatedLink},
+    {QLatin1StringView("%hoveredlink"), HoveredLink},
+    {QLatin1StringView("%link"), Link},
+    {QLatin1StringView("%positivetextcolor"), PositiveTextColor},
+    {QLatin1StringView("%neutraltextcolor"), NeutralTextColor},
+    {QLatin1StringView("%negativetextcolor"), NegativeTextColor},
+    {QLatin1StringView("%fontsize"), FontSize},
+    {QLatin1StringView("%fontfamily"), FontFamily},
+    {QLatin1StringView("%smallfontsize"), SmallFontSize},
+};
+}
+
+ImageSetPrivate::StyleSheetTemplate ImageSetPrivate::compileStyleSheet(const QString &css)
+{
+    StyleSheetTemplate styleSheet;
+
+    qsizetype literalStart = 0;
+    qsizetype pos = 0;
+    while ((pos = css.indexOf(QLatin1Char('%'), pos)) >= 0) {
+        const QStringView rest = QStringView(css).mid(pos);
+        const StyleSheetPlaceholderName *match = nullptr;
+        for (const StyleSheetPlaceholderName &placeholder : s_styleSheetPlaceholders) {
+            if (rest.startsWith(placeholder.name)) {
+                match = &placeholder;
+                break;
+            }
+        }
+        if (!match) {
+            ++pos;
+            continue;
+        }
+
+        styleSheet.literals << css.mid(literalStart, pos - literalStart);
+        styleSheet.placeholders << match->placeholder;
+        styleSheet.usesFonts = styleSheet.usesFonts || match->placeholder >= FontSize;
+        pos += match->name.size();
+        literalStart = pos;
+    }
+    styleSheet.literals << css.mid(literalStart);
+
+    return styleSheet;
+}
 
+QString ImageSetPrivate::fillStyleSheet(const StyleSheetTemplate &styleSheet,
+                                        KSvg::Svg::Status status,
+                                        const QPalette &palette,
+                                        const QColor &positive,
+                                        const QColor &neutral,
+                                        const QColor &negative)
+{
     QPalette::ColorGroup group;
     switch (status) {
     case Svg::Status::Inactive:
@@ -309,70 +537,74 @@ const QString ImageSetPrivate::processStyleSheet(const QString &css,
         group = QPalette::Normal;
     }
 
-    QHash<QString, QString> elements;
-    // If you add elements here, make sure their names are sufficiently unique to not cause
-    // clashes between element keys
+    std::array<QString, PlaceholderCount> values;
     if (status == Svg::Status::Selected) {
-        elements[QStringLiteral("%textcolor")] = palette.color(group, QPalette::HighlightedText).name();
-        elements[QStringLiteral("%backgroundcolor")] = palette.color(group, QPalette::Highlight).name();
+        values[TextColor] = palette.color(group, QPalette::HighlightedText).name();
+        values[BackgroundColor] = palette.color(group, QPalette::Highlight).name();
     } else {
-        elements[QStringLiteral("%textcolor")] = palette.color(group, QPalette::WindowText).name();
-        elements[QStringLiteral("%backgroundcolor")] = palette.color(group, QPalette::Window).name();
-    }
-
-    elements[QStringLiteral("%highlightcolor")] = palette.color(group, QPalette::Highlight).name();
-    elements[QStringLiteral("%highlightedtextcolor")] = palette.color(group, QPalette::HighlightedText).name();
-    elements[QStringLiteral("%visitedlink")] = palette.color(group, QPalette::LinkVisited).name();
-    elements[QStringLiteral("%activatedlink")] = palette.color(group, QPalette::Highlight).name();
-    elements[QStringLiteral("%hoveredlink")] = palette.color(group, QPalette::Highlight).name();
-    elements[QStringLiteral("%link")] = palette.color(group, QPalette::Link).name();
-    elements[QStringLiteral("%positivetextcolor")] = positive.name();
-    elements[QStringLiteral("%neutraltextcolor")] = neutral.name();
-    elements[QStringLiteral("%negativetextcolor")] = negative.name();
-
-    QFont font = QGuiApplication::font();
-    elements[QStringLiteral("%fontsize")] = QStringLiteral("%1pt").arg(font.pointSize());
-    QString family{font.family()};
-    family.truncate(family.indexOf(QLatin1Char('[')));
-    elements[QStringLiteral("%fontfamily")] = family;
-    elements[QStringLiteral("%smallfontsize")] = QStringLiteral("%1pt").arg(QFontDatabase::systemFont(QFontDatabase::SmallestReadableFont).pointSize());
-
-    QHash<QString, QString>::const_iterator it = elements.constBegin();
-    QHash<QString, QString>::const_iterator itEnd = elements.constEnd();
-    for (; it != itEnd; ++it) {
-        stylesheet.replace(it.key(), it.value());
+        values[TextColor] = palette.color(group, QPalette::WindowText).name();
+        values[BackgroundColor] = palette.color(group, QPalette::Window).name();
     }
-    return stylesheet;
+
+    values[HighlightColor] = palette.color(group, QPalette::Highlight).name();
+    values[HighlightedTextColor] = palette.color(group, QPalette::HighlightedText).name();
+    values[VisitedLink] = palette.color(group, QPalette::LinkVisited).name();
+    values[ActivatedLink] = values[HighlightColor];
+    values[HoveredLink] = values[HighlightColor];
+    values[Link] = palette.color(group, QPalette::Link).name();
+    values[PositiveTextColor] = positive.name();
+    values[NeutralTextColor] = neutral.name();
+    values[NegativeTextColor] = negative.name();
+
+    // Only looked up by the style sheets actually using them
+    if (styleSheet.usesFonts) {
+        QFont font = QGuiApplication::font();
+        values[FontSize] = QStringLiteral("%1pt").arg(font.pointSize());
+        QString family{font.family()};
+        family.truncate(family.indexOf(QLatin1Char('[')));
+        values[FontFamily] = family;
+        values[SmallFontSize] = QStringLiteral("%1pt").arg(QFontDatabase::systemFont(QFontDatabase::SmallestReadableFont).pointSize());
+    }
+
+    qsizetype size = 0;
+    for (const QString &literal : styleSheet.literals) {
+        size += literal.size();
+    }
+    for (int placeholder : styleSheet.placeholders) {
+        size += values[placeholder].size();
+    }
+
+    QString result;
+    result.reserve(size);
+    for (qsizetype i = 0; i < styleSheet.placeholders.size(); ++i) {
+        result += styleSheet.literals[i];
+        result += values[styleSheet.placeholders[i]];
+    }
+    result += styleSheet.literals.constLast();
+    return result;
 }
 
 const QString
 ImageSetPrivate::svgStyleSheet(const QPalette &palette, const QColor &positive, const QColor &neutral, const QColor &negative, KSvg::Svg::Status status)
 {
-    QString stylesheet = (status == Svg::Status::Selected)
-        ? cachedSelectedSvgStyleSheets.value(palette.cacheKey())
-        : (status == Svg::Status::Inactive ? cachedInactiveSvgStyleSheets.value(palette.cacheKey()) : cachedSvgStyleSheets.value(palette.cacheKey()));
-    if (stylesheet.isEmpty()) {
-        QString skel = QStringLiteral(".ColorScheme-%1{color:%2;}");
-
-        stylesheet += skel.arg(QStringLiteral("Text"), QStringLiteral("%textcolor"));
-        stylesheet += skel.arg(QStringLiteral("Background"), QStringLiteral("%backgroundcolor"));
-
-        stylesheet += skel.arg(QStringLiteral("Highlight"), QStringLiteral("%highlightcolor"));
-        stylesheet += skel.arg(QStringLiteral("HighlightedText"), QStringLiteral("%highlightedtextcolor"));
-        stylesheet += skel.arg(QStringLiteral("PositiveText"), QStringLiteral("%positivetextcolor"));
-        stylesheet += skel.arg(QStringLiteral("NeutralText"), QStringLiteral("%neutraltextcolor"));
-        stylesheet += skel.arg(QStringLiteral("NegativeText"), QStringLiteral("%negativetextcolor"));
-
-        stylesheet = processStyleSheet(stylesheet, status, palette, positive, neutral, negative);
-        if (status == Svg::Status::Selected) {
-            cachedSelectedSvgStyleSheets.insert(palette.cacheKey(), stylesheet);
-        } else if (status == Svg::Status::Inactive) {
-            cachedInactiveSvgStyleSheets.insert(palette.cacheKey(), stylesheet);
-        } else {
-            cachedSvgStyleSheets.insert(palette.cacheKey(), stylesheet);
-        }
+    const StyleSheetKey key{palette.cacheKey(), positive.rgba(), neutral.rgba(), negative.rgba(), int(status)};
+
+    auto it = cachedSvgStyleSheets.constFind(key);
+    if (it != cachedSvgStyleSheets.constEnd()) {
+        return *it;
     }
 
+    static const StyleSheetTemplate colorScheme = compileStyleSheet(
+        QStringLiteral(".ColorScheme-Text{color:%textcolor;}"
+                       ".ColorScheme-Background{color:%backgroundcolor;}"
+                       ".ColorScheme-Highlight{color:%highlightcolor;}"
+                       ".ColorScheme-HighlightedText{color:%highlightedtextcolor;}"
+                       ".ColorScheme-PositiveText{color:%positivetextcolor;}"
+                       ".ColorScheme-NeutralText{color:%neutraltextcolor;}"
+                       ".ColorScheme-NegativeText{color:%negativetextcolor;}"));
+
+    const QString stylesheet = fillStyleSheet(colorScheme, status, palette, positive, neutral, negative);
+    cachedSvgStyleSheets.insert(key, stylesheet);
     return stylesheet;
 }
 
@@ -387,7 +619,8 @@ bool ImageSetPrivate::findInCache(const QString &key, QPixmap &pix, unsigned int
         return false;
     }
 
-    if (lastModified > uint(pixmapCache->lastModifiedTime().toSecsSinceEpoch())) {
+    if (lastModified > pixmapCacheLastModified()) {
+        StatisticsPrivate::increment(Statistics::PixmapCacheMisses);
         return false;
     }
 
@@ -395,34 +628,201 @@ bool ImageSetPrivate::findInCache(const QString &key, QPixmap &pix, unsigned int
     const auto it = pixmapsToCache.constFind(id);
     if (it != pixmapsToCache.constEnd()) {
         pix = *it;
+        StatisticsPrivate::increment(pix.isNull() ? Statistics::PixmapCacheMisses : Statistics::PixmapCacheHits);
         return !pix.isNull();
     }
 
+    // Spares the lookup in the shared memory and the decoding of pixmaps fetched over and over
+    if (const QPixmap *recent = recentPixmaps.object(key)) {
+        pix = *recent;
+        StatisticsPrivate::increment(Statistics::RecentPixmapHits);
+        StatisticsPrivate::increment(Statistics::PixmapCacheHits);
+        return true;
+    }
+    StatisticsPrivate::increment(Statistics::RecentPixmapMisses);
+
     QPixmap temp;
-    if (pixmapCache->findPixmap(key, &temp) && !temp.isNull()) {
+    if (readPixmap(key, temp) && !temp.isNull()) {
         pix = temp;
+        cacheRecentPixmap(key, temp);
+        updateMemoryStatistics();
+        StatisticsPrivate::increment(Statistics::PixmapCacheHits);
         return true;
     }
 
+    StatisticsPrivate::increment(Statistics::PixmapCacheMisses);
     return false;
 }
 
+PixmapStorage ImageSetPrivate::pixmapStorage()
+{
+    static const PixmapStorage storage = PixmapStorage(std::clamp(qEnvironmentVariableIntValue("KSVG_RAW_PIXMAPS"), 0, 1));
+    return storage;
+}
+
+bool ImageSetPrivate::readPixmap(const QString &key, QPixmap &pix)
+{
+    QMutexLocker locker(PixmapCacheWriter::cacheMutex());
+    if (pixmapStorage() == EncodedPixmaps) {
+        return pixmapCache->findPixmap(key, &pix);
+    }
+
+    QByteArray data;
+    if (!pixmapCache->find(key, &data)) {
+        return false;
+    }
+    locker.unlock();
+
+    QImage image = decodeRawPixmap(data);
+    if (image.isNull()) {
+        return false;
+    }
+
+    pix = QPixmap::fromImage(std::move(image));
+    return true;
+}
+
+void ImageSetPrivate::writePixmap(const QString &key, const QPixmap &pix)
+{
+    // Pixmaps can't leave the GUI thread, images can
+    if (PixmapCacheWriter *writer = PixmapCacheWriter::instance()) {
+        writer->write(pixmapCache, key, pix.toImage(), pixmapStorage());
+    } else {
+        // At exit, once the writer is gone
+        PixmapCacheWriter::writeNow(pixmapCache, key, pix.toImage(), pixmapStorage());
+    }
+}
+
+QByteArray ImageSetPrivate::encodeRawPixmap(const QImage &sourceImage)
+{
+    const QImage image = sourceImage.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    if (image.isNull()) {
+        return QByteArray();
+    }
+
+    RawPixmapHeader header;
+    memcpy(header.magic, s_rawPixmapMagic, sizeof(s_rawPixmapMagic));
+    header.reserved = 0;
+    header.width = image.width();
+    header.height = image.height();
+    header.bytesPerLine = image.bytesPerLine();
+    header.padding = 0;
+    header.devicePixelRatio = image.devicePixelRatio();
+
+    QByteArray data;
+    data.reserve(sizeof(header) + image.sizeInBytes());
+    data.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    data.append(reinterpret_cast<const char *>(image.constBits()), image.sizeInBytes());
+    return data;
+}
+
+QImage ImageSetPrivate::decodeRawPixmap(const QByteArray &data)
+{
+    if (data.size() < qsizetype(sizeof(RawPixmapHeader))) {
+        return QImage();
+    }
+
+    RawPixmapHeader header;
+    memcpy(&header, data.constData(), sizeof(header));
+    if (memcmp(header.magic, s_rawPixmapMagic, sizeof(s_rawPixmapMagic)) != 0 || header.reserved != 0 || header.width <= 0 || header.height <= 0
+        || header.bytesPerLine < qint64(header.width) * 4 || header.bytesPerLine % 4 != 0
+        || data.size() - qsizetype(sizeof(header)) != qsizetype(header.bytesPerLine) * header.height) {
+        return QImage();
+    }
+
+    // Straight over the rows of data, which the image keeps alive: the only copy is the one made by the pixmap
+    auto *rows = new QByteArray(data);
+    QImage image(
+        reinterpret_cast<const uchar *>(rows->constData()) + sizeof(header),
+        header.width,
+        header.height,
+        header.bytesPerLine,
+        QImage::Format_ARGB32_Premultiplied,
+        [](void *rows) {
+            delete static_cast<QByteArray *>(rows);
+        },
+        rows);
+    if (image.isNull()) {
+        delete rows;
+        return QImage();
+    }
+    image.setDevicePixelRatio(header.devicePixelRatio);
+    return image;
+}
+
+void ImageSetPrivate::resetPixmapCache()
+{
+    if (!pixmapCache) {
+        return;
+    }
+
+    // Null once destroyed at exit, after having written what it still had queued
+    if (PixmapCacheWriter *writer = PixmapCacheWriter::instance()) {
+        writer->flush();
+    }
+    delete pixmapCache;
+    pixmapCache = nullptr;
+}
+
+uint ImageSetPrivate::pixmapCacheLastModified()
+{
+    QMutexLocker locker(PixmapCacheWriter::cacheMutex());
+    return uint(pixmapCache->lastModifiedTime().toSecsSinceEpoch());
+}
+
+bool ImageSetPrivate::findDisplayList(const QString &key, QByteArray &data, unsigned int lastModified)
+{
+    if (!useCache() || lastModified > pixmapCacheLastModified()) {
+        return false;
+    }
+
+    QMutexLocker locker(PixmapCacheWriter::cacheMutex());
+    return pixmapCache->find(key, &data);
+}
+
+bool ImageSetPrivate::hasDisplayList(const QString &key)
+{
+    if (!useCache()) {
+        return false;
+    }
+
+    QMutexLocker locker(PixmapCacheWriter::cacheMutex());
+    return pixmapCache->contains(key);
+}
+
+void ImageSetPrivate::insertDisplayList(const QString &key, const QByteArray &data)
+{
+    if (useCache()) {
+        {
+            QMutexLocker locker(PixmapCacheWriter::cacheMutex());
+            pixmapCache->insert(key, data);
+        }
+        updatePixmapCacheStatistics();
+    }
+}
+
 void ImageSetPrivate::insertIntoCache(const QString &key, const QPixmap &pix)
 {
     if (useCache()) {
-        pixmapCache->insertPixmap(key, pix);
+        writePixmap(key, pix);
+        cacheRecentPixmap(key, pix);
+        StatisticsPrivate::increment(Statistics::PixmapCacheInserts);
+        updateMemoryStatistics();
+        updatePixmapCacheStatistics();
     }
 }
 
 void ImageSetPrivate::insertIntoCache(const QString &key, const QPixmap &pix, const QString &id)
 {
     if (useCache()) {
-        pixmapsToCache[id] = pix;
+        queuePixmap(id, pix);
         keysToCache[key] = id;
         idsToCache[id] = key;
 
         // always start timer in pixmapSaveTimer's thread
         QMetaObject::invokeMethod(pixmapSaveTimer, "start", Qt::QueuedConnection);
+
+        updateMemoryStatistics();
     }
 }
 
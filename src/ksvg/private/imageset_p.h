@@ -8,8 +8,11 @@
 #ifndef KSVG_IMAGESET_P_H
 #define KSVG_IMAGESET_P_H
 
+#include "autotest_export_p.h"
 #include "imageset.h"
 #include "svg.h"
+#include "themebundle_p.h"
+#include <QCache>
 #include <QHash>
 
 #include <KImageCache>
@@ -32,7 +35,33 @@ enum CacheType {
 Q_DECLARE_FLAGS(CacheTypes, CacheType)
 Q_DECLARE_OPERATORS_FOR_FLAGS(CacheTypes)
 
-class ImageSetPrivate : public QObject, public QSharedData
+// How pixmaps are stored in the pixmap cache, set with the KSVG_RAW_PIXMAPS environment variable
+enum PixmapStorage {
+    EncodedPixmaps = 0, // What KImageCache does
+    RawPixmaps = 1, // Premultiplied ARGB32 rows
+};
+
+// What the color scheme style sheet depends on
+struct StyleSheetKey {
+    qint64 paletteKey;
+    QRgb positive;
+    QRgb neutral;
+    QRgb negative;
+    int status;
+
+    bool operator==(const StyleSheetKey &other) const
+    {
+        return paletteKey == other.paletteKey && positive == other.positive && neutral == other.neutral && negative == other.negative
+            && status == other.status;
+    }
+};
+
+inline size_t qHash(const StyleSheetKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.paletteKey, key.positive, key.neutral, key.negative, key.status);
+}
+
+class KSVG_AUTOTEST_EXPORT ImageSetPrivate : public QObject, public QSharedData
 {
     Q_OBJECT
 
@@ -41,20 +70,32 @@ public:
     ~ImageSetPrivate() override;
 
     QString imagePath(const QString &theme, const QString &type, const QString &image);
+    ThemeBundle::Ptr themeBundle(const QString &theme);
     QString findInImageSet(const QString &image, const QString &theme, bool cache = true);
     void discardCache(CacheTypes caches);
+    // Drops what is cached by path for a single file, whose content changed
+    void discardFile(const QString &path);
     void scheduleImageSetChangeNotification(CacheTypes caches);
     bool useCache();
     void setImageSetName(const QString &themeName, bool emitChanged);
 
-    const QString processStyleSheet(const QString &css,
-                                    KSvg::Svg::Status status,
-                                    const QPalette &palette,
-                                    const QColor &positive,
-                                    const QColor &neutral,
-                                    const QColor &negative);
     const QString svgStyleSheet(const QPalette &palette, const QColor &positive, const QColor &neutral, const QColor &negative, KSvg::Svg::Status status);
 
+    // A style sheet split around its placeholders, such as %textcolor
+    struct StyleSheetTemplate {
+        // One more than placeholders: the text before each placeholder, then the text after the last one
+        QStringList literals;
+        QList<int> placeholders;
+        bool usesFonts = false;
+    };
+    static StyleSheetTemplate compileStyleSheet(const QString &css);
+    static QString fillStyleSheet(const StyleSheetTemplate &styleSheet,
+                                  KSvg::Svg::Status status,
+                                  const QPalette &palette,
+                                  const QColor &positive,
+                                  const QColor &neutral,
+                                  const QColor &negative);
+
     /**
      * TODO: timestamp shouldn't be user-provided
      * Check with file timestamp
@@ -102,6 +143,46 @@ public:
      **/
     void insertIntoCache(const QString &key, const QPixmap &pix, const QString &id);
 
+    static PixmapStorage pixmapStorage();
+    // Read and write pixmaps in pixmapCache, in the format of pixmapStorage(). Writes are done by PixmapCacheWriter
+    bool readPixmap(const QString &key, QPixmap &pix);
+    void writePixmap(const QString &key, const QPixmap &pix);
+    static QByteArray encodeRawPixmap(const QImage &image);
+    // Null if data is not a valid raw pixmap. The image references data rather than copying it
+    static QImage decodeRawPixmap(const QByteArray &data);
+
+    // Deletes pixmapCache, once all the writes still queued for it are done
+    void resetPixmapCache();
+    // Time of the last insertion in pixmapCache, which must exist
+    uint pixmapCacheLastModified();
+
+    /**
+     * Display lists of the svg elements, stored as raw data in the pixmap cache.
+     * A display list is only found if it's newer than lastModified.
+     **/
+    bool findDisplayList(const QString &key, QByteArray &data, unsigned int lastModified);
+    bool hasDisplayList(const QString &key);
+    void insertDisplayList(const QString &key, const QByteArray &data);
+
+    /**
+     * Updates the memory gauges of KSvg::Statistics with what this image set
+     * currently holds in memory.
+     **/
+    void updateMemoryStatistics();
+
+    /**
+     * Updates the gauge of the bytes used in pixmapCache, which has to lock
+     * the shared memory: only done when the statistics are enabled.
+     **/
+    void updatePixmapCacheStatistics();
+
+    // Adds a pixmap to pixmapsToCache, keeping pendingPixmapBytes up to date
+    void queuePixmap(const QString &id, const QPixmap &pix);
+    void clearQueuedPixmaps();
+
+    // Keeps a decoded copy of a pixmap of pixmapCache in recentPixmaps
+    void cacheRecentPixmap(const QString &key, const QPixmap &pix);
+
 public Q_SLOTS:
     void scheduledCacheUpdate();
     void onAppExitCleanup();
@@ -129,12 +210,18 @@ public:
     KConfigGroup cfg;
     KImageCache *pixmapCache;
     QHash<QString, QPixmap> pixmapsToCache;
+    // Running total of the bytes held by pixmapsToCache
+    qint64 pendingPixmapBytes = 0;
     QHash<QString, QString> keysToCache;
     QHash<QString, QString> idsToCache;
-    QHash<qint64, QString> cachedSvgStyleSheets;
-    QHash<qint64, QString> cachedSelectedSvgStyleSheets;
-    QHash<qint64, QString> cachedInactiveSvgStyleSheets;
+    // Rendered corners and tiles of frames, shared by all their sizes
+    QCache<quint64, QPixmap> frameSlices;
+    // Decoded copies of the pixmaps recently found in or written to pixmapCache, by the same keys
+    QCache<QString, QPixmap> recentPixmaps;
+    QHash<StyleSheetKey, QString> cachedSvgStyleSheets;
     QHash<QString, QString> discoveries;
+    // Precompiled bundles by theme name, null for the themes without one
+    QHash<QString, ThemeBundle::Ptr> themeBundles;
     QTimer *pixmapSaveTimer;
     QTimer *updateNotificationTimer;
     unsigned cacheSize;
@@ -142,6 +229,11 @@ public:
     QString themeVersion;
     QString themeMetadataPath;
     QString iconImageSetMetadataPath;
+    // What this image set contributes to the memory gauges of KSvg::Statistics
+    qint64 reportedPixmapCacheBytes = 0;
+    qint64 reportedPendingPixmapBytes = 0;
+    qint64 reportedFrameSliceBytes = 0;
+    qint64 reportedRecentPixmapBytes = 0;
 
     bool isDefault : 1;
     bool useGlobal : 1;
@@ -0,0 +1,161 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "maskbuilder_p.h"
+
+#include <QList>
+#include <QRect>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace KSvg
+{
+namespace MaskBuilder
+{
+// Pixels with an alpha above this are part of the mask
+static const uint s_alphaThreshold = 127;
+
+// Runs are stored as pairs of start and end (excluded) x coordinates
+using Runs = QList<int>;
+
+static inline bool isVisible(QRgb pixel)
+{
+    return qAlpha(pixel) > int(s_alphaThreshold);
+}
+
+static inline void appendRun(Runs &runs, int start, int end)
+{
+    if (!runs.isEmpty() && runs.last() == start) {
+        runs.last() = end;
+    } else {
+        runs << start << end;
+    }
+}
+
+// Appends the runs of visible pixels of line between from and to (excluded)
+static void scanRuns(const QRgb *line, int from, int to, Runs &runs)
+{
+    int x = from;
+    int runStart = -1;
+
+#ifdef __SSE2__
+    const __m128i threshold = _mm_set1_epi32(s_alphaThreshold);
+    for (; x + 4 <= to; x += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(line + x));
+        const __m128i alpha = _mm_srli_epi32(pixels, 24);
+        const int visible = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(alpha, threshold)));
+
+        // Most of the time the four pixels just continue the current state
+        if (visible == 0xF && runStart >= 0) {
+            continue;
+        }
+        if (visible == 0 && runStart < 0) {
+            continue;
+        }
+
+        for (int i = 0; i < 4; ++i) {
+            if (visible & (1 << i)) {
+                if (runStart < 0) {
+                    runStart = x + i;
+                }
+            } else if (runStart >= 0) {
+                appendRun(runs, runStart, x + i);
+                runStart = -1;
+            }
+        }
+    }
+#endif
+
+    for (; x < to; ++x) {
+        if (isVisible(line[x])) {
+            if (runStart < 0) {
+                runStart = x;
+            }
+        } else if (runStart >= 0) {
+            appendRun(runs, runStart, x);
+            runStart = -1;
+        }
+    }
+
+    if (runStart >= 0) {
+        appendRun(runs, runStart, to);
+    }
+}
+
+/*
+ * Collects the runs of each row, merging consecutive identical rows into
+ * a single band, which is the y-x banded form QRegion::setRects() expects
+ */
+class RegionBuilder
+{
+public:
+    void addRow(int y, const Runs &runs)
+    {
+        if (runs == m_bandRuns && y == m_bandTop + m_bandHeight) {
+            ++m_bandHeight;
+            return;
+        }
+
+        flush();
+        m_bandRuns = runs;
+        m_bandTop = y;
+        m_bandHeight = 1;
+    }
+
+    QRegion region()
+    {
+        flush();
+
+        QRegion region;
+        if (!m_rects.isEmpty()) {
+            region.setRects(m_rects.constData(), m_rects.size());
+        }
+        return region;
+    }
+
+private:
+    void flush()
+    {
+        for (int i = 0; i + 1 < m_bandRuns.size(); i += 2) {
+            m_rects << QRect(m_bandRuns[i], m_bandTop, m_bandRuns[i + 1] - m_bandRuns[i], m_bandHeight);
+        }
+        m_bandRuns.clear();
+        m_bandHeight = 0;
+    }
+
+    QList<QRect> m_rects;
+    Runs m_bandRuns;
+    int m_bandTop = 0;
+    int m_bandHeight = 0;
+};
+
+static QImage premultipliedImage(const QImage &image)
+{
+    if (image.format() == QImage::Format_ARGB32_Premultiplied || image.format() == QImage::Format_ARGB32) {
+        return image;
+    }
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+QRegion regionFromAlpha(const QImage &image)
+{
+    const QImage argbImage = premultipliedImage(image);
+
+    RegionBuilder builder;
+    Runs runs;
+    for (int y = 0; y < argbImage.height(); ++y) {
+        runs.clear();
+        scanRuns(reinterpret_cast<const QRgb *>(argbImage.constScanLine(y)), 0, argbImage.width(), runs);
+        builder.addRow(y, runs);
+    }
+
+    return builder.region();
+}
+
+}
+}
@@ -0,0 +1,27 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KSVG_MASKBUILDER_P_H
+#define KSVG_MASKBUILDER_P_H
+
+#include <QImage>
+#include <QRegion>
+
+#include "autotest_export_p.h"
+
+namespace KSvg
+{
+namespace MaskBuilder
+{
+/**
+ * @returns the region covered by the pixels of @p image with an alpha of at least 50%,
+ * the same threshold used by QPixmap::mask()
+ */
+KSVG_AUTOTEST_EXPORT QRegion regionFromAlpha(const QImage &image);
+}
+}
+
+#endif
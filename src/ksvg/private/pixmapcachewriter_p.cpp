@@ -0,0 +1,127 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "pixmapcachewriter_p.h"
+
+#include <QThread>
+
+#include <KImageCache>
+
+namespace KSvg
+{
+Q_GLOBAL_STATIC(PixmapCacheWriter, s_pixmapCacheWriter)
+
+// Trivially destructible: unlike the writer, it is still usable by the caches deleted at exit
+static QBasicMutex s_cacheMutex;
+
+PixmapCacheWriter::PixmapCacheWriter()
+    : m_thread(QThread::create([this]() {
+        run();
+    }))
+{
+    m_thread->setObjectName(QStringLiteral("KSvg pixmap cache writer"));
+    m_thread->start(QThread::LowPriority);
+}
+
+PixmapCacheWriter::~PixmapCacheWriter()
+{
+    m_stopping.store(true, std::memory_order_release);
+    m_pending.release();
+    m_thread->wait();
+    delete m_thread;
+
+    // Caches are flushed before being deleted: whatever is still queued is for caches that still exist
+    writeQueue();
+}
+
+PixmapCacheWriter *PixmapCacheWriter::instance()
+{
+    return s_pixmapCacheWriter();
+}
+
+void PixmapCacheWriter::write(KImageCache *cache, const QString &key, const QImage &image, PixmapStorage storage)
+{
+    Write *write = new Write{nullptr, cache, key, image, storage};
+
+    write->next = m_queue.load(std::memory_order_relaxed);
+    while (!m_queue.compare_exchange_weak(write->next, write, std::memory_order_release, std::memory_order_relaxed)) { }
+
+    m_queuedCount.fetch_add(1, std::memory_order_release);
+    m_pending.release();
+}
+
+void PixmapCacheWriter::writeNow(KImageCache *cache, const QString &key, const QImage &image, PixmapStorage storage)
+{
+    if (storage == EncodedPixmaps) {
+        QMutexLocker locker(&s_cacheMutex);
+        cache->insertImage(key, image);
+        return;
+    }
+
+    // Not encoded while holding the lock
+    const QByteArray data = ImageSetPrivate::encodeRawPixmap(image);
+    if (!data.isEmpty()) {
+        QMutexLocker locker(&s_cacheMutex);
+        cache->insert(key, data);
+    }
+}
+
+QBasicMutex *PixmapCacheWriter::cacheMutex()
+{
+    return &s_cacheMutex;
+}
+
+void PixmapCacheWriter::flush()
+{
+    const quint64 target = m_queuedCount.load(std::memory_order_acquire);
+
+    QMutexLocker locker(&m_mutex);
+    while (m_writtenCount < target) {
+        m_written.wait(&m_mutex);
+    }
+}
+
+quint64 PixmapCacheWriter::writeQueue()
+{
+    // Newest first: reverse to write in queue order, so that the last write of a key wins
+    Write *stack = m_queue.exchange(nullptr, std::memory_order_acquire);
+    Write *write = nullptr;
+    while (stack) {
+        Write *next = stack->next;
+        stack->next = write;
+        write = stack;
+        stack = next;
+    }
+
+    quint64 count = 0;
+    while (write) {
+        writeNow(write->cache, write->key, write->image, write->storage);
+        Write *next = write->next;
+        delete write;
+        write = next;
+        ++count;
+    }
+    return count;
+}
+
+void PixmapCacheWriter::run()
+{
+    while (true) {
+        m_pending.acquire();
+        m_pending.tryAcquire(m_pending.available());
+        if (m_stopping.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        const quint64 count = writeQueue();
+
+        QMutexLocker locker(&m_mutex);
+        m_writtenCount += count;
+        m_written.wakeAll();
+    }
+}
+
+}
@@ -0,0 +1,84 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KSVG_PIXMAPCACHEWRITER_P_H
+#define KSVG_PIXMAPCACHEWRITER_P_H
+
+#include <QImage>
+#include <QMutex>
+#include <QSemaphore>
+#include <QString>
+#include <QWaitCondition>
+
+#include <atomic>
+
+#include "autotest_export_p.h"
+#include "imageset_p.h"
+
+class KImageCache;
+class QThread;
+
+namespace KSvg
+{
+/**
+ * Process wide thread writing the rendered images into the pixmap caches,
+ * so that writing a burst of them never stalls painting.
+ *
+ * Images are queued without taking any lock: writes are pushed on a lock free
+ * stack, which the writer thread takes whole and replays in order.
+ * A pixmap cache must be flushed before being deleted, and only used with
+ * cacheMutex() held while writes may be queued for it.
+ */
+class KSVG_AUTOTEST_EXPORT PixmapCacheWriter
+{
+public:
+    PixmapCacheWriter();
+    ~PixmapCacheWriter();
+
+    static PixmapCacheWriter *instance();
+
+    // Stores image as key in cache, in the given format, in its own time
+    void write(KImageCache *cache, const QString &key, const QImage &image, PixmapStorage storage);
+
+    // Waits until all the writes queued so far are done
+    void flush();
+
+    // Stores image as key in cache right away, in the calling thread
+    static void writeNow(KImageCache *cache, const QString &key, const QImage &image, PixmapStorage storage);
+
+    /**
+     * KImageCache is not thread safe: held by the writer thread while it writes
+     * in a cache, and by the other threads while they use one.
+     */
+    static QBasicMutex *cacheMutex();
+
+private:
+    struct Write {
+        Write *next;
+        KImageCache *cache;
+        QString key;
+        QImage image;
+        PixmapStorage storage;
+    };
+
+    void run();
+    // Writes everything queued so far, returns how many writes that was
+    quint64 writeQueue();
+
+    QThread *m_thread;
+    std::atomic<Write *> m_queue{nullptr};
+    std::atomic<quint64> m_queuedCount{0};
+    std::atomic<bool> m_stopping{false};
+    QSemaphore m_pending;
+
+    QMutex m_mutex;
+    QWaitCondition m_written;
+    quint64 m_writtenCount = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,34 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KSVG_STABLEHASH_P_H
+#define KSVG_STABLEHASH_P_H
+
+#include <QStringView>
+
+namespace KSvg
+{
+static constexpr quint32 s_stableHashBasis = 0x811c9dc5;
+
+/**
+ * 32 bit FNV-1a of the UTF-16 code units of string, least significant byte first.
+ *
+ * Unlike qHash(), which is randomly seeded per process and may change between
+ * Qt versions, the result only depends on string and seed: use it for every
+ * hash that is written in a file and read back by another process.
+ */
+inline quint32 stableHash(QStringView string, quint32 seed = s_stableHashBasis)
+{
+    quint32 hash = seed;
+    for (const QChar c : string) {
+        hash = (hash ^ (c.unicode() & 0xff)) * 0x01000193;
+        hash = (hash ^ (c.unicode() >> 8)) * 0x01000193;
+    }
+    return hash;
+}
+}
+
+#endif
@@ -0,0 +1,51 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KSVG_STATISTICS_P_H
+#define KSVG_STATISTICS_P_H
+
+#include "statistics.h"
+
+#include <QElapsedTimer>
+
+namespace KSvg
+{
+namespace StatisticsPrivate
+{
+void increment(Statistics::Counter counter, quint64 value = 1);
+void setGauge(Statistics::Gauge gauge, qint64 value);
+void adjustGauge(Statistics::Gauge gauge, qint64 delta);
+void record(Statistics::Timer timer, qint64 nanoseconds);
+
+// Whether the statistics are dumped at exit, the gauges that are expensive to
+// keep up to date are only tracked then
+bool enabled();
+
+// Records the time spent in its scope
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Statistics::Timer timer)
+        : m_timer(timer)
+    {
+        m_elapsed.start();
+    }
+
+    ~ScopedTimer()
+    {
+        record(m_timer, m_elapsed.nsecsElapsed());
+    }
+
+private:
+    Q_DISABLE_COPY(ScopedTimer)
+
+    Statistics::Timer m_timer;
+    QElapsedTimer m_elapsed;
+};
+}
+}
+
+#endif
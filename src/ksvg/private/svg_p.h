@@ -7,52 +7,179 @@
 #ifndef KSVG_SVG_P_H
 #define KSVG_SVG_P_H
 
+#include "autotest_export_p.h"
 #include "svg.h"
+#include "svgrectscachefile_p.h"
+#include "svgrectstore_p.h"
 
 #include <QExplicitlySharedDataPointer>
 #include <QHash>
+#include <QMutex>
 #include <QObject>
 #include <QPalette>
+#include <QPicture>
 #include <QPointer>
 #include <QSharedData>
 #include <QSvgRenderer>
 
 namespace KSvg
 {
-class SharedSvgRenderer : public QSvgRenderer, public QSharedData
+class ThemeBundle;
+
+/**
+ * The content of an svg file, read once and shared by all the renderers
+ * of that file, whatever style sheet is applied to them.
+ */
+class KSVG_AUTOTEST_EXPORT SvgDocument : public QSharedData
+{
+public:
+    typedef QExplicitlySharedDataPointer<SvgDocument> Ptr;
+
+    // Bytes of the document replaced by the style sheet: the content of a current-color-scheme
+    // style element, or the "/>" ending it when it's empty
+    struct StyleRange {
+        qsizetype start;
+        qsizetype end;
+        bool selfClosing;
+    };
+
+    // Bytes of the value of an id attribute
+    struct ElementId {
+        qsizetype start;
+        qsizetype length;
+        // Length of the "16-16-" prefix of size hinted ids, 0 for the others
+        qsizetype sizeHintLength;
+    };
+
+    // What a single scan of the document finds out about it, without parsing it as XML
+    struct Index {
+        QList<StyleRange> colorSchemeStyles;
+        QList<ElementId> elementIds;
+    };
+
+    explicit SvgDocument(const QString &path);
+    ~SvgDocument();
+
+    QString path() const;
+    QByteArray contents() const;
+
+    // Only documents with a current-color-scheme style element depend on the style sheet
+    bool isStyleable() const;
+    QList<StyleRange> colorSchemeStyles() const;
+    QList<ElementId> elementIds() const;
+
+    /**
+     * Sorted stableHash() of all the element ids of the document.
+     * @return false if some ids can't be compared as they are written, e.g. because they contain entities
+     * or the document is not in UTF-8
+     */
+    bool elementIdHashes(QList<quint32> &hashes) const;
+
+    static Index index(const QByteArray &contents);
+    // Returns the length of the "width-height-" prefix of a size hinted id, or 0 if the id has no size hint
+    static qsizetype sizeHintLength(QByteArrayView id);
+    static qsizetype sizeHintLength(QStringView id);
+    static QByteArray applyStyleSheet(const QByteArray &contents, const QList<StyleRange> &styles, const QString &styleSheet);
+
+    // Elements with a size hinted id, collected on the first renderer created for the document
+    bool hasInterestingElements() const;
+    QHash<QString, QRectF> interestingElements() const;
+    void collectInterestingElements(QSvgRenderer *renderer);
+
+    void reload();
+
+private:
+    QString m_path;
+    // Keeps the bundle the contents come from mapped, if any
+    QExplicitlySharedDataPointer<ThemeBundle> m_bundle;
+    QByteArray m_contents;
+    QHash<QString, QRectF> m_interestingElements;
+    Index m_index;
+    bool m_interestingElementsCollected = false;
+};
+
+class KSVG_AUTOTEST_EXPORT SharedSvgRenderer : public QSvgRenderer, public QSharedData
 {
     Q_OBJECT
 public:
     typedef QExplicitlySharedDataPointer<SharedSvgRenderer> Ptr;
 
     explicit SharedSvgRenderer(QObject *parent = nullptr);
-    SharedSvgRenderer(const QString &filename, const QString &styleSheet, QHash<QString, QRectF> &interestingElements, QObject *parent = nullptr);
+    SharedSvgRenderer(const SvgDocument::Ptr &document, const QString &styleSheet, QObject *parent = nullptr);
 
     SharedSvgRenderer(const QByteArray &contents, const QString &styleSheet, QHash<QString, QRectF> &interestingElements, QObject *parent = nullptr);
 
+    SvgDocument::Ptr document() const;
+
+    // QSvgRenderer is not reentrant: must be held while using it from a render thread, or while it may be used from one
+    QMutex *mutex();
+
     void reload();
 
 private:
-    bool load(const QByteArray &contents, const QString &styleSheet, QHash<QString, QRectF> &interestingElements);
+    bool load(const QByteArray &contents, const QString &styleSheet, const QList<SvgDocument::StyleRange> &styles);
 
-    QString m_filename;
+    SvgDocument::Ptr m_document;
     QString m_styleSheet;
-    QHash<QString, QRectF> m_interestingElements;
+    QMutex m_mutex;
+};
+
+/**
+ * A file path or element id interned in a process wide table: equal strings
+ * are the same atom, so they are compared by address and hashed only once.
+ * Atoms live as long as the process.
+ */
+class KSVG_AUTOTEST_EXPORT SvgAtom
+{
+public:
+    // Doesn't allocate if the string has already been interned
+    static const SvgAtom *intern(QStringView string);
+
+    const QString string;
+    // stableHash(string), the hash of the string that goes into cache ids and element id filters
+    const size_t hash;
+    // stableHash() of the string independent from the first one, for the fingerprints of cache ids
+    const size_t fingerprint;
+
+private:
+    explicit SvgAtom(QStringView string, size_t hash);
 };
 
 class SvgPrivate
 {
 public:
-    struct CacheId {
+    struct KSVG_AUTOTEST_EXPORT CacheId {
+        CacheId(double width,
+                double height,
+                const SvgAtom *filePath,
+                const SvgAtom *elementName,
+                int status,
+                double scaleFactor,
+                qint64 paletteKey,
+                uint extraFlags,
+                uint lastModified);
+
         double width;
         double height;
-        QString filePath;
-        QString elementName;
+        const SvgAtom *filePath;
+        const SvgAtom *elementName;
         int status;
         double scaleFactor;
         qint64 paletteKey;
         uint extraFlags; // Not used here, used for enabledborders in FrameSvg
         uint lastModified;
+        // Computed once on construction, with SvgRectsCache::s_seed
+        uint hash;
+        // Independent hash of the same fields, checked on cache hits to catch collisions of hash
+        quint32 fingerprint;
+
+        // 64 bit key of the rects cache and of the in memory caches
+        quint64 key() const
+        {
+            return quint64(fingerprint) << 32 | hash;
+        }
+        // key() encoded in a short string for the pixmap cache, without formatting a number
+        QString pixmapKey() const;
     };
 
     SvgPrivate(Svg *svg);
@@ -62,34 +189,67 @@ public:
 
     // This function is meant for the rects cache
     CacheId cacheId(QStringView elementId) const;
+    CacheId cacheId(const SvgAtom *elementId) const;
+    // Scales a rect cached at the natural size to the current size
+    QRectF scaledToSize(const QRectF &rect) const;
 
     // This function is meant for the pixmap cache
     QString cachePath(const QString &path, const QSize &size) const;
 
+    // The atom of path, interned again only when path changes
+    const SvgAtom *pathAtom() const;
+
     bool setImagePath(const QString &imagePath);
+    // naturalSize of path at scaleFactor, from the rects cache when it's there
+    void loadNaturalSize();
+    // Caches again what is known of path after its content changed
+    void fileChanged();
+
+    // Reads path again, once for its shared document and all the renderers made from it
+    static void reloadFile(const QString &path);
 
     ImageSet *actualImageSet();
     ImageSet *cacheAndColorsImageSet();
 
+    // Painter commands of an element, recorded once and replayed at any size without a renderer
+    struct DisplayList {
+        QRectF bounds;
+        QRectF recordedRect;
+        QPicture picture;
+    };
+
     QPixmap findInCache(const QString &elementId, const QSizeF &s = QSizeF());
+    QFuture<QImage> findInCacheAsync(const QString &elementId, const QSizeF &s);
+    QSize resolveElement(const QString &elementId, const QSizeF &s, QString &actualElementId);
 
     void createRenderer();
+    void cacheInterestingElements(const QHash<QString, QRectF> &interestingElements);
     void eraseRenderer();
+    // Drops the reference of a render job, and the renderer from the cache if no Svg uses it anymore
+    static void releaseJobRenderer(SharedSvgRenderer::Ptr &renderer);
 
     QRectF elementRect(QStringView elementId);
     QRectF findAndCacheElementRect(QStringView elementId);
 
     // Following two are utility functions to snap rendered elements to the pixel grid
     // to and from are always 0 <= val <= 1
-    qreal closestDistance(qreal to, qreal from);
+    static qreal closestDistance(qreal to, qreal from);
 
-    QRectF makeUniform(const QRectF &orig, const QRectF &dst);
+    static QRectF makeUniform(const QRectF &orig, const QRectF &dst);
+
+    // Display lists are enabled with the KSVG_DISPLAY_LISTS environment variable
+    static bool useDisplayLists();
+    QString displayListKey(const QString &elementId) const;
+    bool findDisplayList(const QString &elementId, DisplayList &displayList);
+    void recordDisplayList(const QString &elementId);
+    static void playDisplayList(QPainter *painter, const DisplayList &displayList, const QSize &size);
 
     // Slots
     void imageSetChanged();
     void colorsChanged();
 
     static QHash<QString, SharedSvgRenderer::Ptr> s_renderers;
+    static QHash<QString, SvgDocument::Ptr> s_documents;
     static QPointer<ImageSet> s_systemColorsCache;
     static qreal s_lastScaleFactor;
 
@@ -98,6 +258,10 @@ public:
     SharedSvgRenderer::Ptr renderer;
     QString themePath;
     QString path;
+    // The path of this svg in SvgRectsCache::watchFile()
+    QString watchedPath;
+    mutable QString m_atomPath;
+    mutable const SvgAtom *m_pathAtom = nullptr;
     QSizeF size;
     QSizeF naturalSize;
     QChar styleCrc;
@@ -114,19 +278,20 @@ public:
     bool themeFailed : 1;
 };
 
-class SvgRectsCache : public QObject
+class KSVG_AUTOTEST_EXPORT SvgRectsCache : public QObject
 {
     Q_OBJECT
 public:
     SvgRectsCache(QObject *parent = nullptr);
+    ~SvgRectsCache() override;
 
     static SvgRectsCache *instance();
 
-    void insert(SvgPrivate::CacheId cacheId, const QRectF &rect, unsigned int lastModified);
-    void insert(uint id, const QString &filePath, const QRectF &rect, unsigned int lastModified);
-    // Those 2 methods are the same, the second uses the integer id produced by hashed CacheId
-    bool findElementRect(SvgPrivate::CacheId cacheId, QRectF &rect);
-    bool findElementRect(uint id, QStringView filePath, QRectF &rect);
+    void insert(const SvgPrivate::CacheId &cacheId, const QRectF &rect, unsigned int lastModified);
+    void insert(quint64 key, const QString &filePath, const QRectF &rect, unsigned int lastModified);
+    // Those 2 methods are the same, the second uses the integer key of CacheId::key()
+    bool findElementRect(const SvgPrivate::CacheId &cacheId, QRectF &rect);
+    bool findElementRect(quint64 key, QStringView filePath, QRectF &rect);
 
     bool loadImageFromCache(const QString &path, uint lastModified);
     void dropImageFromCache(const QString &path);
@@ -142,31 +307,67 @@ public:
 
     QStringList cachedKeysForPath(const QString &path) const;
 
+    /**
+     * Existence filter of the element ids of a file, persisted with the rects.
+     * mayHaveElement() is false only when the file, as of lastModified, is known
+     * not to have any element with an id of that hash.
+     */
+    void setElementIds(const QString &path, unsigned int lastModified, const QList<quint32> &idHashes);
+    bool mayHaveElement(const SvgAtom *path, unsigned int lastModified, const SvgAtom *elementId);
+
     unsigned int lastModifiedTimeFromCache(const QString &filePath);
 
     void updateLastModified(const QString &filePath, unsigned int lastModified);
 
+    /**
+     * Watches path while at least one svg uses it. When the file changes, only its
+     * renderers and rects are dropped, and lastModifiedChanged() is emitted for it.
+     */
+    void watchFile(const QString &path);
+    void unwatchFile(const QString &path);
+
     static const uint s_seed;
 
 Q_SIGNALS:
     void lastModifiedChanged(const QString &filePath, unsigned int lastModified);
 
 private:
-    QTimer *m_configSyncTimer = nullptr;
+    void scheduleSync();
+    void sync();
+    SvgRectsCacheFile::ImageData &pendingImage(const QString &path);
+    void insertLocalRect(quint64 key, const SvgAtom *file, const QRectF &rect);
+    void fileChanged(const QString &path);
+
+    struct ElementIdFilter {
+        unsigned int lastModified = 0;
+        bool known = false;
+        QList<quint32> idHashes;
+    };
+    ElementIdFilter loadElementIdFilter(const QString &path, unsigned int lastModified);
+
+    QTimer *m_syncTimer = nullptr;
     QString m_iconThemePath;
-    KSharedConfigPtr m_svgElementsCache;
+    bool m_iconThemePathChanged = false;
+    QString m_cacheFilePath;
+    // Memory mapped content of the on disk cache, as of the last sync
+    SvgRectsCacheFile m_cacheFile;
     /*
-     * We are indexing in the hash cache ids by their "digested" uint out of qHash(CacheId)
-     * because we need to serialize it and unserialize it to a config file,
-     * which is more efficient to do that with the uint directly rather than a CacheId struct serialization
+     * We are indexing in the hash cache ids by their "digested" 64 bit CacheId::key()
+     * because we need to serialize it and unserialize it to the cache file,
+     * which is more efficient to do that with the integer directly rather than a CacheId struct serialization
      */
-    QHash<uint, QRectF> m_localRectCache;
-    QHash<QString, QSet<unsigned int>> m_invalidElements;
-    QHash<QString, QList<QSize>> m_sizeHintsForId;
+    SvgRectStore m_localRectCache;
+    // By path and element id
+    QHash<std::pair<QString, QString>, QList<QSize>> m_sizeHintsForId;
     QHash<QString, unsigned int> m_lastModifiedTimes;
+    // Changes not written yet to the cache file
+    QHash<QString, SvgRectsCacheFile::ImageData> m_pendingImages;
+    QSet<QString> m_droppedImages;
+    // Loaded on first use, by path
+    QHash<const SvgAtom *, ElementIdFilter> m_elementIdFilters;
+    // Number of svgs using each watched file
+    QHash<QString, int> m_watchedFiles;
 };
 }
 
-uint qHash(const KSvg::SvgPrivate::CacheId &id, uint seed = 0);
-
 #endif
@@ -0,0 +1,246 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+// Scanning of the svg documents, also built into ksvg-themecompile
+
+#include "svg_p.h"
+#include "stablehash_p.h"
+
+#include <algorithm>
+
+namespace KSvg
+{
+static char16_t codeUnit(char c)
+{
+    return uchar(c);
+}
+
+static char16_t codeUnit(QChar c)
+{
+    return c.unicode();
+}
+
+template<typename View>
+static qsizetype sizeHintPrefixLength(View id)
+{
+    qsizetype i = 0;
+    for (int part = 0; part < 2; ++part) {
+        const qsizetype digitsStart = i;
+        while (i < id.size() && codeUnit(id[i]) >= u'0' && codeUnit(id[i]) <= u'9') {
+            ++i;
+        }
+        if (i == digitsStart || i >= id.size() || codeUnit(id[i]) != u'-') {
+            return 0;
+        }
+        ++i;
+    }
+    // The actual element name can't be empty
+    return i < id.size() ? i : 0;
+}
+
+qsizetype SvgDocument::sizeHintLength(QByteArrayView id)
+{
+    return sizeHintPrefixLength(id);
+}
+
+qsizetype SvgDocument::sizeHintLength(QStringView id)
+{
+    return sizeHintPrefixLength(id);
+}
+
+static bool isXmlSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Whether the bytes of the document are what the XML parser reads: UTF-8 or ASCII, without a byte order mark
+static bool isUtf8Document(const QByteArray &contents)
+{
+    if (contents.startsWith("\xEF\xBB\xBF") || contents.startsWith("\xFE\xFF") || contents.startsWith("\xFF\xFE")) {
+        return false;
+    }
+    // UTF-16 or UTF-32 without a byte order mark
+    if (contents.size() >= 2 && (contents[0] == '\0' || contents[1] == '\0')) {
+        return false;
+    }
+
+    if (!contents.startsWith("<?xml")) {
+        return true;
+    }
+    const qsizetype declarationEnd = contents.indexOf("?>");
+    const QByteArray declaration = contents.left(declarationEnd < 0 ? contents.size() : declarationEnd);
+    qsizetype pos = declaration.indexOf("encoding");
+    if (pos < 0) {
+        return true;
+    }
+
+    pos += qstrlen("encoding");
+    while (pos < declaration.size() && (declaration[pos] == '=' || isXmlSpace(declaration[pos]))) {
+        ++pos;
+    }
+    if (pos >= declaration.size() || (declaration[pos] != '"' && declaration[pos] != '\'')) {
+        return false;
+    }
+    const qsizetype valueEnd = declaration.indexOf(declaration[pos], pos + 1);
+    if (valueEnd < 0) {
+        return false;
+    }
+
+    const QByteArray encoding = declaration.mid(pos + 1, valueEnd - pos - 1);
+    return encoding.compare("UTF-8", Qt::CaseInsensitive) == 0 || encoding.compare("US-ASCII", Qt::CaseInsensitive) == 0;
+}
+
+bool SvgDocument::elementIdHashes(QList<quint32> &hashes) const
+{
+    hashes.clear();
+    // The ids are hashed as they are written, which would give false negatives for other encodings.
+    // The hashes are stored in the rects cache file, they must stay the same across processes and Qt versions
+    if (!isUtf8Document(m_contents)) {
+        return false;
+    }
+
+    hashes.reserve(m_index.elementIds.size());
+    for (const ElementId &id : m_index.elementIds) {
+        const QByteArrayView bytes(m_contents.constData() + id.start, id.length);
+        // The XML parser resolves entities and normalizes white space in attribute values
+        for (const char c : bytes) {
+            if (c == '&' || c == '\t' || c == '\n' || c == '\r') {
+                return false;
+            }
+        }
+        hashes.append(stableHash(QString::fromUtf8(bytes)));
+    }
+
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    return true;
+}
+
+// Returns the position right after the first occurrence of terminator from pos, or the end of contents
+static qsizetype skipPast(const QByteArray &contents, const char *terminator, qsizetype pos)
+{
+    const qsizetype found = contents.indexOf(terminator, pos);
+    return found < 0 ? contents.size() : found + qstrlen(terminator);
+}
+
+SvgDocument::Index SvgDocument::index(const QByteArray &contents)
+{
+    Index index;
+
+    const char *data = contents.constData();
+    const qsizetype size = contents.size();
+    const QByteArrayView colorSchemeId("current-color-scheme");
+
+    qsizetype pos = 0;
+    while ((pos = contents.indexOf('<', pos)) >= 0) {
+        const QByteArrayView tag(data + pos, size - pos);
+        if (tag.startsWith("<!--")) {
+            pos = skipPast(contents, "-->", pos + 4);
+            continue;
+        }
+        if (tag.startsWith("<![CDATA[")) {
+            pos = skipPast(contents, "]]>", pos + 9);
+            continue;
+        }
+        // End tags, processing instructions and declarations
+        if (tag.size() < 2 || tag[1] == '/' || tag[1] == '?' || tag[1] == '!') {
+            ++pos;
+            continue;
+        }
+
+        qsizetype i = pos + 1;
+        while (i < size && !isXmlSpace(data[i]) && data[i] != '>' && data[i] != '/') {
+            ++i;
+        }
+        const QByteArrayView tagName(data + pos + 1, i - pos - 1);
+
+        // Walk the attributes up to the end of the start tag
+        qsizetype tagEnd = -1;
+        qsizetype selfClosingStart = -1;
+        qsizetype idStart = -1;
+        qsizetype idLength = 0;
+        while (i < size) {
+            while (i < size && isXmlSpace(data[i])) {
+                ++i;
+            }
+            if (i >= size) {
+                break;
+            }
+            if (data[i] == '>') {
+                tagEnd = i + 1;
+                break;
+            }
+            if (data[i] == '/') {
+                if (i + 1 < size && data[i + 1] == '>') {
+                    selfClosingStart = i;
+                    tagEnd = i + 2;
+                }
+                break;
+            }
+
+            const qsizetype nameStart = i;
+            while (i < size && !isXmlSpace(data[i]) && data[i] != '=' && data[i] != '>' && data[i] != '/') {
+                ++i;
+            }
+            const QByteArrayView name(data + nameStart, i - nameStart);
+            while (i < size && isXmlSpace(data[i])) {
+                ++i;
+            }
+            if (i >= size || data[i] != '=') {
+                break;
+            }
+            ++i;
+            while (i < size && isXmlSpace(data[i])) {
+                ++i;
+            }
+            if (i >= size || (data[i] != '"' && data[i] != '\'')) {
+                break;
+            }
+            const char quote = data[i];
+            const qsizetype valueStart = ++i;
+            while (i < size && data[i] != quote) {
+                ++i;
+            }
+            if (i >= size) {
+                break;
+            }
+            // Like QSvgRenderer, fall back to xml:id
+            if (name == "id" || (name == "xml:id" && idStart < 0)) {
+                idStart = valueStart;
+                idLength = i - valueStart;
+            }
+            ++i;
+        }
+
+        if (tagEnd < 0) {
+            // Malformed document, QSvgRenderer won't load it anyways
+            break;
+        }
+
+        if (idStart >= 0) {
+            const QByteArrayView id(data + idStart, idLength);
+            index.elementIds.append({idStart, idLength, sizeHintLength(id)});
+
+            if (tagName == "style" && id == colorSchemeId) {
+                if (selfClosingStart >= 0) {
+                    index.colorSchemeStyles.append({selfClosingStart, tagEnd, true});
+                } else {
+                    const qsizetype styleEnd = contents.indexOf("</style", tagEnd);
+                    if (styleEnd < 0) {
+                        break;
+                    }
+                    index.colorSchemeStyles.append({tagEnd, styleEnd, false});
+                    tagEnd = styleEnd;
+                }
+            }
+        }
+        pos = tagEnd;
+    }
+
+    return index;
+}
+
+}
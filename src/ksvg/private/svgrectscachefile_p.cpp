@@ -0,0 +1,460 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "svgrectscachefile_p.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <QSaveFile>
+
+#include "debug_p.h"
+#include "stablehash_p.h"
+
+namespace KSvg
+{
+// Bump every time the layout of the file or the meaning of the stored ids changes
+const quint32 SvgRectsCacheFile::s_version = 7;
+
+static const char s_magic[4] = {'K', 'S', 'V', 'G'};
+static const quint32 s_byteOrder = 0x01020304;
+
+static_assert(sizeof(SvgRectsCacheFile::Header) == 48);
+static_assert(sizeof(SvgRectsCacheFile::PathEntry) == 56);
+static_assert(sizeof(SvgRectsCacheFile::RectRecord) == 48);
+static_assert(sizeof(SvgRectsCacheFile::NaturalSizeRecord) == 24);
+static_assert(sizeof(SvgRectsCacheFile::SizeHintRecord) == 24);
+
+// Stored in the file, so it must give the same result in every process
+static quint32 hashString(QStringView string)
+{
+    return stableHash(string);
+}
+
+static quint32 nextPowerOfTwo(quint32 value)
+{
+    quint32 result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+SvgRectsCacheFile::SvgRectsCacheFile() = default;
+
+SvgRectsCacheFile::~SvgRectsCacheFile()
+{
+    close();
+}
+
+bool SvgRectsCacheFile::open(const QString &fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size < qint64(sizeof(Header))) {
+        close();
+        return false;
+    }
+
+    m_data = m_file.map(0, m_size);
+    if (!m_data || !validate()) {
+        if (m_data) {
+            qCDebug(LOG_KSVG) << "Ignoring invalid or outdated rects cache" << fileName;
+        }
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void SvgRectsCacheFile::close()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+        m_data = nullptr;
+    }
+    m_size = 0;
+    m_file.close();
+}
+
+bool SvgRectsCacheFile::isOpen() const
+{
+    return m_data;
+}
+
+bool SvgRectsCacheFile::validate() const
+{
+    const Header *h = header();
+    if (memcmp(h->magic, s_magic, sizeof(s_magic)) != 0 || h->version != s_version || h->byteOrder != s_byteOrder || h->fileSize != quint64(m_size)) {
+        return false;
+    }
+
+    auto fits = [this](quint64 offset, quint64 count, quint64 recordSize) {
+        return offset + count * recordSize <= quint64(m_size);
+    };
+
+    if (!fits(h->stringPoolOffset, h->stringPoolSize, 1) || h->stringPoolOffset % 2 != 0 //
+        || quint64(h->iconThemePathOffset) + quint64(h->iconThemePathLength) * 2 > h->stringPoolSize //
+        || !fits(h->pathTableOffset, h->pathTableCapacity, sizeof(PathEntry)) || h->pathTableOffset % 8 != 0 //
+        || h->pathTableCapacity == 0 || (h->pathTableCapacity & (h->pathTableCapacity - 1)) != 0) {
+        return false;
+    }
+
+    // Lookups stop at the first empty slot, make sure there always is one
+    quint32 usedSlots = 0;
+    const auto *entries = reinterpret_cast<const PathEntry *>(m_data + h->pathTableOffset);
+    for (quint32 i = 0; i < h->pathTableCapacity; ++i) {
+        const PathEntry &entry = entries[i];
+        if (entry.pathLength == 0) {
+            continue;
+        }
+        ++usedSlots;
+        if (quint64(entry.pathOffset) + quint64(entry.pathLength) * 2 > h->stringPoolSize //
+            || !fits(entry.rectsOffset, entry.rectsCapacity, sizeof(RectRecord)) || entry.rectsOffset % 8 != 0 //
+            || (entry.rectsCapacity & (entry.rectsCapacity - 1)) != 0 //
+            || !fits(entry.naturalSizesOffset, entry.naturalSizesCount, sizeof(NaturalSizeRecord)) || entry.naturalSizesOffset % 8 != 0 //
+            || !fits(entry.sizeHintsOffset, entry.sizeHintsCount, sizeof(SizeHintRecord)) || entry.sizeHintsOffset % 8 != 0 //
+            || !fits(entry.elementIdsOffset, entry.elementIdsCount, sizeof(quint32)) || entry.elementIdsOffset % 4 != 0) {
+            return false;
+        }
+
+        const auto *sizeHints = reinterpret_cast<const SizeHintRecord *>(m_data + entry.sizeHintsOffset);
+        for (quint32 j = 0; j < entry.sizeHintsCount; ++j) {
+            if (quint64(sizeHints[j].idOffset) + quint64(sizeHints[j].idLength) * 2 > h->stringPoolSize) {
+                return false;
+            }
+        }
+    }
+
+    return usedSlots < h->pathTableCapacity;
+}
+
+QStringView SvgRectsCacheFile::string(quint32 offset, quint32 length) const
+{
+    return QStringView(reinterpret_cast<const QChar *>(m_data + header()->stringPoolOffset + offset), length);
+}
+
+const SvgRectsCacheFile::PathEntry *SvgRectsCacheFile::findImage(QStringView path) const
+{
+    if (!m_data || path.isEmpty()) {
+        return nullptr;
+    }
+
+    const Header *h = header();
+    const auto *entries = reinterpret_cast<const PathEntry *>(m_data + h->pathTableOffset);
+    const quint32 hash = hashString(path);
+    const quint32 mask = h->pathTableCapacity - 1;
+
+    for (quint32 i = hash & mask;; i = (i + 1) & mask) {
+        const PathEntry &entry = entries[i];
+        if (entry.pathLength == 0) {
+            return nullptr;
+        }
+        if (entry.hash == hash && string(entry.pathOffset, entry.pathLength) == path) {
+            return &entry;
+        }
+    }
+}
+
+QString SvgRectsCacheFile::iconThemePath() const
+{
+    if (!m_data) {
+        return QString();
+    }
+    return string(header()->iconThemePathOffset, header()->iconThemePathLength).toString();
+}
+
+bool SvgRectsCacheFile::findElementRect(const PathEntry *image, quint64 key, QRectF &rect) const
+{
+    if (!image || image->rectsCapacity == 0) {
+        return false;
+    }
+
+    const quint32 id = quint32(key);
+    const quint32 fingerprint = quint32(key >> 32);
+
+    const auto *records = reinterpret_cast<const RectRecord *>(m_data + image->rectsOffset);
+    const quint32 mask = image->rectsCapacity - 1;
+
+    for (quint32 probes = 0, i = id & mask; probes < image->rectsCapacity; ++probes, i = (i + 1) & mask) {
+        const RectRecord &record = records[i];
+        if (record.flags == EmptyRecord) {
+            return false;
+        }
+        if (record.id == id && record.fingerprint == fingerprint) {
+            rect = record.flags == ValidRecord ? QRectF(record.x, record.y, record.width, record.height) : QRectF();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QSizeF SvgRectsCacheFile::naturalSize(const PathEntry *image, qreal scaleFactor) const
+{
+    if (!image) {
+        return QSizeF();
+    }
+
+    const auto *records = reinterpret_cast<const NaturalSizeRecord *>(m_data + image->naturalSizesOffset);
+    for (quint32 i = 0; i < image->naturalSizesCount; ++i) {
+        if (qFuzzyCompare(records[i].scaleFactor, scaleFactor)) {
+            return QSizeF(records[i].width, records[i].height);
+        }
+    }
+
+    return QSizeF();
+}
+
+QList<QSize> SvgRectsCacheFile::sizeHintsForId(const PathEntry *image, QStringView id) const
+{
+    QList<QSize> sizes;
+    if (!image || image->sizeHintsCount == 0) {
+        return sizes;
+    }
+
+    const auto *begin = reinterpret_cast<const SizeHintRecord *>(m_data + image->sizeHintsOffset);
+    const auto *end = begin + image->sizeHintsCount;
+    const quint32 hash = hashString(id);
+
+    auto it = std::lower_bound(begin, end, hash, [](const SizeHintRecord &record, quint32 hash) {
+        return record.idHash < hash;
+    });
+    for (; it != end && it->idHash == hash; ++it) {
+        if (string(it->idOffset, it->idLength) == id) {
+            sizes << QSize(it->width, it->height);
+        }
+    }
+
+    return sizes;
+}
+
+QList<quint64> SvgRectsCacheFile::rectKeys(const PathEntry *image) const
+{
+    QList<quint64> keys;
+    if (!image) {
+        return keys;
+    }
+
+    const auto *records = reinterpret_cast<const RectRecord *>(m_data + image->rectsOffset);
+    for (quint32 i = 0; i < image->rectsCapacity; ++i) {
+        if (records[i].flags != EmptyRecord) {
+            keys << (quint64(records[i].fingerprint) << 32 | records[i].id);
+        }
+    }
+
+    return keys;
+}
+
+bool SvgRectsCacheFile::elementIds(const PathEntry *image, QList<quint32> &idHashes) const
+{
+    if (!image || !(image->flags & HasElementIds)) {
+        return false;
+    }
+
+    const auto *begin = reinterpret_cast<const quint32 *>(m_data + image->elementIdsOffset);
+    idHashes = QList<quint32>(begin, begin + image->elementIdsCount);
+    return true;
+}
+
+QHash<QString, SvgRectsCacheFile::ImageData> SvgRectsCacheFile::images() const
+{
+    QHash<QString, ImageData> images;
+    if (!m_data) {
+        return images;
+    }
+
+    const Header *h = header();
+    const auto *entries = reinterpret_cast<const PathEntry *>(m_data + h->pathTableOffset);
+    for (quint32 i = 0; i < h->pathTableCapacity; ++i) {
+        const PathEntry &entry = entries[i];
+        if (entry.pathLength == 0) {
+            continue;
+        }
+
+        ImageData &image = images[string(entry.pathOffset, entry.pathLength).toString()];
+        image.lastModified = entry.lastModified;
+
+        const auto *rects = reinterpret_cast<const RectRecord *>(m_data + entry.rectsOffset);
+        for (quint32 j = 0; j < entry.rectsCapacity; ++j) {
+            const RectRecord &record = rects[j];
+            const quint64 key = quint64(record.fingerprint) << 32 | record.id;
+            if (record.flags == ValidRecord) {
+                image.rects.insert(key, QRectF(record.x, record.y, record.width, record.height));
+            } else if (record.flags == InvalidRecord) {
+                image.rects.insert(key, QRectF());
+            }
+        }
+
+        const auto *naturalSizes = reinterpret_cast<const NaturalSizeRecord *>(m_data + entry.naturalSizesOffset);
+        for (quint32 j = 0; j < entry.naturalSizesCount; ++j) {
+            image.naturalSizes.insert(naturalSizes[j].scaleFactor, QSizeF(naturalSizes[j].width, naturalSizes[j].height));
+        }
+
+        const auto *sizeHints = reinterpret_cast<const SizeHintRecord *>(m_data + entry.sizeHintsOffset);
+        for (quint32 j = 0; j < entry.sizeHintsCount; ++j) {
+            image.sizeHints[string(sizeHints[j].idOffset, sizeHints[j].idLength).toString()] << QSize(sizeHints[j].width, sizeHints[j].height);
+        }
+
+        image.hasElementIds = elementIds(&entry, image.elementIds);
+    }
+
+    return images;
+}
+
+bool SvgRectsCacheFile::write(const QString &fileName, const QString &iconThemePath, const QHash<QString, ImageData> &images)
+{
+    QByteArray data(sizeof(Header), '\0');
+
+    auto align = [&data](int alignment) {
+        while (data.size() % alignment != 0) {
+            data.append('\0');
+        }
+    };
+
+    // String pool first, so every following record can reference it
+    QByteArray pool;
+    auto addString = [&pool](QStringView string) {
+        const quint32 offset = pool.size();
+        pool.append(reinterpret_cast<const char *>(string.utf16()), string.size() * 2);
+        return offset;
+    };
+
+    Header header;
+    memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = s_version;
+    header.byteOrder = s_byteOrder;
+    header.iconThemePathOffset = addString(iconThemePath);
+    header.iconThemePathLength = iconThemePath.size();
+
+    std::vector<PathEntry> entries;
+    entries.reserve(images.size());
+    QHash<QString, quint32> stringOffsets;
+    for (auto it = images.constBegin(); it != images.constEnd(); ++it) {
+        if (it.key().isEmpty()) {
+            continue;
+        }
+        PathEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.hash = hashString(it.key());
+        entry.pathOffset = addString(it.key());
+        entry.pathLength = it.key().size();
+        entry.lastModified = it->lastModified;
+        entries.push_back(entry);
+
+        for (auto hintIt = it->sizeHints.constBegin(); hintIt != it->sizeHints.constEnd(); ++hintIt) {
+            if (!stringOffsets.contains(hintIt.key())) {
+                stringOffsets.insert(hintIt.key(), addString(hintIt.key()));
+            }
+        }
+    }
+
+    header.stringPoolOffset = data.size();
+    header.stringPoolSize = pool.size();
+    data.append(pool);
+
+    // Per image records
+    auto entryIt = entries.begin();
+    for (auto it = images.constBegin(); it != images.constEnd(); ++it) {
+        if (it.key().isEmpty()) {
+            continue;
+        }
+        PathEntry &entry = *entryIt++;
+
+        align(8);
+        entry.rectsOffset = data.size();
+        entry.rectsCapacity = it->rects.isEmpty() ? 0 : nextPowerOfTwo(it->rects.size() * 2);
+        std::vector<RectRecord> records(entry.rectsCapacity);
+        memset(records.data(), 0, records.size() * sizeof(RectRecord));
+        const quint32 mask = entry.rectsCapacity - 1;
+        for (auto rectIt = it->rects.constBegin(); rectIt != it->rects.constEnd(); ++rectIt) {
+            quint32 i = quint32(rectIt.key()) & mask;
+            while (records[i].flags != EmptyRecord) {
+                i = (i + 1) & mask;
+            }
+            RectRecord &record = records[i];
+            record.id = quint32(rectIt.key());
+            record.fingerprint = quint32(rectIt.key() >> 32);
+            const QRectF &rect = rectIt.value();
+            if (rect.isValid()) {
+                record.flags = ValidRecord;
+                record.x = rect.x();
+                record.y = rect.y();
+                record.width = rect.width();
+                record.height = rect.height();
+            } else {
+                record.flags = InvalidRecord;
+            }
+        }
+        data.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(RectRecord));
+
+        entry.naturalSizesOffset = data.size();
+        entry.naturalSizesCount = it->naturalSizes.size();
+        for (auto sizeIt = it->naturalSizes.constBegin(); sizeIt != it->naturalSizes.constEnd(); ++sizeIt) {
+            const NaturalSizeRecord record{sizeIt.key(), sizeIt->width(), sizeIt->height()};
+            data.append(reinterpret_cast<const char *>(&record), sizeof(record));
+        }
+
+        std::vector<SizeHintRecord> hints;
+        for (auto hintIt = it->sizeHints.constBegin(); hintIt != it->sizeHints.constEnd(); ++hintIt) {
+            for (const QSize &size : hintIt.value()) {
+                hints.push_back(
+                    SizeHintRecord{hashString(hintIt.key()), stringOffsets.value(hintIt.key()), quint32(hintIt.key().size()), size.width(), size.height(), 0});
+            }
+        }
+        std::stable_sort(hints.begin(), hints.end(), [](const SizeHintRecord &a, const SizeHintRecord &b) {
+            return a.idHash < b.idHash;
+        });
+        entry.sizeHintsOffset = data.size();
+        entry.sizeHintsCount = hints.size();
+        data.append(reinterpret_cast<const char *>(hints.data()), hints.size() * sizeof(SizeHintRecord));
+
+        entry.elementIdsOffset = data.size();
+        if (it->hasElementIds) {
+            entry.flags |= HasElementIds;
+            entry.elementIdsCount = it->elementIds.size();
+            data.append(reinterpret_cast<const char *>(it->elementIds.constData()), it->elementIds.size() * sizeof(quint32));
+        }
+    }
+
+    // Path table last, now that all the offsets are known
+    align(8);
+    header.pathTableOffset = data.size();
+    header.pathTableCapacity = nextPowerOfTwo(std::max<quint32>(1, entries.size() * 2));
+    header.pathCount = entries.size();
+    std::vector<PathEntry> table(header.pathTableCapacity);
+    memset(table.data(), 0, table.size() * sizeof(PathEntry));
+    const quint32 mask = header.pathTableCapacity - 1;
+    for (const PathEntry &entry : entries) {
+        quint32 i = entry.hash & mask;
+        while (table[i].pathLength != 0) {
+            i = (i + 1) & mask;
+        }
+        table[i] = entry;
+    }
+    data.append(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(PathEntry));
+
+    header.fileSize = data.size();
+    memcpy(data.data(), &header, sizeof(header));
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qCWarning(LOG_KSVG) << "Could not write the rects cache" << fileName << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+}
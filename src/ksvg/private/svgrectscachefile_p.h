@@ -0,0 +1,160 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KSVG_SVGRECTSCACHEFILE_P_H
+#define KSVG_SVGRECTSCACHEFILE_P_H
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QRectF>
+#include <QSize>
+#include <QSizeF>
+#include <QString>
+
+#include "autotest_export_p.h"
+
+namespace KSvg
+{
+/**
+ * Binary, memory mapped storage of the SvgRectsCache.
+ *
+ * The file is made of a header, a string pool, and for each image file an
+ * open addressing table of fixed size element rect records, followed by its
+ * natural sizes, size hints and the hashes of its element ids. Images are found
+ * through a hashed path table. Opening a file only maps it: all the lookups
+ * read the mapped memory directly, without parsing or allocating anything.
+ *
+ * The file is never modified in place: write() produces a complete new file
+ * which atomically replaces the old one.
+ */
+class KSVG_AUTOTEST_EXPORT SvgRectsCacheFile
+{
+public:
+    static const quint32 s_version;
+
+    struct Header {
+        char magic[4];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 pathTableOffset;
+        quint32 pathTableCapacity;
+        quint32 pathCount;
+        quint32 stringPoolOffset;
+        quint32 stringPoolSize;
+        quint32 iconThemePathOffset;
+        quint32 iconThemePathLength;
+        quint64 fileSize;
+    };
+
+    struct PathEntry {
+        quint32 hash;
+        quint32 pathOffset;
+        quint32 pathLength; // 0 for an unused slot
+        quint32 lastModified;
+        quint32 rectsOffset;
+        quint32 rectsCapacity;
+        quint32 naturalSizesOffset;
+        quint32 naturalSizesCount;
+        quint32 sizeHintsOffset;
+        quint32 sizeHintsCount;
+        quint32 elementIdsOffset;
+        quint32 elementIdsCount;
+        quint32 flags;
+        quint32 padding;
+    };
+
+    enum PathFlag : quint32 {
+        HasElementIds = 1,
+    };
+
+    enum RecordFlag : quint32 {
+        EmptyRecord = 0,
+        ValidRecord = 1,
+        InvalidRecord = 2,
+    };
+
+    // Found by the low 32 bits of the key, the high ones are a fingerprint checked on lookup
+    struct RectRecord {
+        quint32 id;
+        quint32 fingerprint;
+        quint32 flags;
+        quint32 padding;
+        double x;
+        double y;
+        double width;
+        double height;
+    };
+
+    struct NaturalSizeRecord {
+        double scaleFactor;
+        double width;
+        double height;
+    };
+
+    // Sorted by idHash
+    struct SizeHintRecord {
+        quint32 idHash;
+        quint32 idOffset;
+        quint32 idLength;
+        qint32 width;
+        qint32 height;
+        quint32 padding;
+    };
+
+    // Unpacked data of a single image, used to build a new file
+    struct ImageData {
+        unsigned int lastModified = 0;
+        // invalid elements are stored as null rects
+        QHash<quint64, QRectF> rects;
+        QHash<qreal, QSizeF> naturalSizes;
+        QHash<QString, QList<QSize>> sizeHints;
+        // Sorted stableHash() of all the element ids of the file, only meaningful if hasElementIds
+        QList<quint32> elementIds;
+        bool hasElementIds = false;
+    };
+
+    SvgRectsCacheFile();
+    ~SvgRectsCacheFile();
+
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const;
+
+    const PathEntry *findImage(QStringView path) const;
+
+    QString iconThemePath() const;
+    bool findElementRect(const PathEntry *image, quint64 key, QRectF &rect) const;
+    QSizeF naturalSize(const PathEntry *image, qreal scaleFactor) const;
+    QList<QSize> sizeHintsForId(const PathEntry *image, QStringView id) const;
+    QList<quint64> rectKeys(const PathEntry *image) const;
+    // @return false if the element ids of the image aren't known
+    bool elementIds(const PathEntry *image, QList<quint32> &idHashes) const;
+
+    /**
+     * Unpacks the whole content of the file, used when merging it with
+     * the pending changes before writing a new version.
+     */
+    QHash<QString, ImageData> images() const;
+
+    static bool write(const QString &fileName, const QString &iconThemePath, const QHash<QString, ImageData> &images);
+
+private:
+    const Header *header() const
+    {
+        return reinterpret_cast<const Header *>(m_data);
+    }
+    QStringView string(quint32 offset, quint32 length) const;
+    bool validate() const;
+
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+};
+
+}
+
+#endif
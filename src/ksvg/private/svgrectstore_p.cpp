@@ -0,0 +1,159 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "svgrectstore_p.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace KSvg
+{
+static constexpr qsizetype s_minimumCapacity = 64;
+
+qsizetype SvgRectStore::probe(quint64 key) const
+{
+    // Keys are hashes already: their low bits are used as they are
+    const qsizetype mask = m_slots.size() - 1;
+    qsizetype i = qsizetype(key & quint64(mask));
+    while (m_slots[i].state != Empty && m_slots[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+quint32 SvgRectStore::tick()
+{
+    if (++m_clock == 0) {
+        // Wrapped around: forget the usage history rather than evicting the wrong entries
+        for (Slot &slot : m_slots) {
+            slot.lastUsed = 0;
+        }
+        m_clock = 1;
+    }
+    return m_clock;
+}
+
+SvgRectStore::Lookup SvgRectStore::find(quint64 key, QRectF &rect)
+{
+    if (m_slots.isEmpty()) {
+        return Missing;
+    }
+
+    Slot &slot = m_slots[probe(key)];
+    switch (slot.state) {
+    case Occupied:
+        slot.lastUsed = tick();
+        rect = slot.rect;
+        return Found;
+    case Dead:
+        slot.lastUsed = tick();
+        rect = QRectF();
+        return Tombstone;
+    case Empty:
+    case Removed:
+        break;
+    }
+    return Missing;
+}
+
+bool SvgRectStore::contains(quint64 key) const
+{
+    if (m_slots.isEmpty()) {
+        return false;
+    }
+    const SlotState state = m_slots[probe(key)].state;
+    return state == Occupied || state == Dead;
+}
+
+void SvgRectStore::insert(quint64 key, const SvgAtom *file, const QRectF &rect)
+{
+    if (m_maximumSize > 0 && m_size >= m_maximumSize) {
+        evict();
+    }
+
+    // Keep the table at most half full, so that probe sequences stay short
+    if ((m_size + 1) * 2 > m_slots.size()) {
+        rehash(std::max(s_minimumCapacity, m_slots.size() * 2));
+    }
+
+    Slot &slot = m_slots[probe(key)];
+    if (slot.state != Occupied && slot.state != Dead) {
+        ++m_size;
+    }
+    slot.key = key;
+    slot.state = rect.isValid() ? Occupied : Dead;
+    slot.file = file;
+    slot.lastUsed = tick();
+    slot.rect = rect.isValid() ? rect : QRectF();
+}
+
+void SvgRectStore::removeFile(const SvgAtom *file)
+{
+    bool removed = false;
+    for (Slot &slot : m_slots) {
+        if ((slot.state == Occupied || slot.state == Dead) && slot.file == file) {
+            slot.state = Removed;
+            --m_size;
+            removed = true;
+        }
+    }
+
+    if (removed) {
+        rehash(m_slots.size());
+    }
+}
+
+void SvgRectStore::setMaximumSize(qsizetype maximumSize)
+{
+    m_maximumSize = maximumSize;
+    while (m_maximumSize > 0 && m_size > m_maximumSize) {
+        evict();
+    }
+}
+
+void SvgRectStore::evict()
+{
+    // Drop the least recently used quarter at once, so that the cost of evicting is spread over many inserts
+    std::vector<quint32> ticks;
+    ticks.reserve(m_size);
+    for (const Slot &slot : std::as_const(m_slots)) {
+        if (slot.state == Occupied || slot.state == Dead) {
+            ticks.push_back(slot.lastUsed);
+        }
+    }
+    if (ticks.empty()) {
+        return;
+    }
+
+    const auto threshold = ticks.begin() + std::max<size_t>(1, ticks.size() / 4) - 1;
+    std::nth_element(ticks.begin(), threshold, ticks.end());
+
+    qsizetype toEvict = threshold - ticks.begin() + 1;
+    for (Slot &slot : m_slots) {
+        if (toEvict > 0 && (slot.state == Occupied || slot.state == Dead) && slot.lastUsed <= *threshold) {
+            slot.state = Removed;
+            --m_size;
+            --toEvict;
+        }
+    }
+
+    rehash(m_slots.size());
+}
+
+void SvgRectStore::rehash(qsizetype capacity)
+{
+    QList<Slot> oldSlots(capacity);
+    oldSlots.swap(m_slots);
+
+    for (const Slot &slot : std::as_const(oldSlots)) {
+        if (slot.state == Occupied || slot.state == Dead) {
+            m_slots[probe(slot.key)] = slot;
+        }
+    }
+}
+
+}
@@ -0,0 +1,91 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KSVG_SVGRECTSTORE_P_H
+#define KSVG_SVGRECTSTORE_P_H
+
+#include <QList>
+#include <QRectF>
+
+#include "autotest_export_p.h"
+
+namespace KSvg
+{
+class SvgAtom;
+
+/**
+ * In memory element rects of the SvgRectsCache, by 64 bit cache key.
+ *
+ * Elements known not to exist are stored as tombstones in the same open
+ * addressing table as the valid rects: positive and negative lookups are a
+ * single probe, and neither allocates.
+ *
+ * The store holds at most maximumSize() entries: past that, the least
+ * recently used ones are evicted, a quarter of the table at once. Entries
+ * remember their file, so that all the rects of a file can be dropped when
+ * it changes.
+ */
+class KSVG_AUTOTEST_EXPORT SvgRectStore
+{
+public:
+    enum Lookup {
+        Missing,
+        Found,
+        Tombstone,
+    };
+
+    // On Tombstone, rect is set to a null rect
+    Lookup find(quint64 key, QRectF &rect);
+    bool contains(quint64 key) const;
+
+    // An invalid rect is stored as a tombstone
+    void insert(quint64 key, const SvgAtom *file, const QRectF &rect);
+    void removeFile(const SvgAtom *file);
+
+    qsizetype size() const
+    {
+        return m_size;
+    }
+
+    // 0 for no limit
+    qsizetype maximumSize() const
+    {
+        return m_maximumSize;
+    }
+    void setMaximumSize(qsizetype maximumSize);
+
+private:
+    enum SlotState : quint32 {
+        Empty = 0,
+        Occupied,
+        Dead,
+        // Evicted or removed, only until the next rehash
+        Removed,
+    };
+
+    struct Slot {
+        quint64 key = 0;
+        SlotState state = Empty;
+        quint32 lastUsed = 0;
+        const SvgAtom *file = nullptr;
+        QRectF rect;
+    };
+
+    // Index of the slot holding key, or of the empty slot where it would go
+    qsizetype probe(quint64 key) const;
+    quint32 tick();
+    void evict();
+    void rehash(qsizetype capacity);
+
+    QList<Slot> m_slots;
+    qsizetype m_size = 0;
+    qsizetype m_maximumSize = 0;
+    quint32 m_clock = 0;
+};
+
+}
+
+#endif
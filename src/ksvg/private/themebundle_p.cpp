@@ -0,0 +1,255 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "themebundle_p.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QFileInfo>
+
+#include "debug_p.h"
+
+namespace KSvg
+{
+static_assert(sizeof(ThemeBundle::Header) == 40);
+static_assert(sizeof(ThemeBundle::ImageEntry) == 56);
+static_assert(sizeof(ThemeBundle::StyleRecord) == 16);
+static_assert(sizeof(ThemeBundle::ElementRecord) == 88);
+
+struct OpenedBundle {
+    ThemeBundle::Ptr bundle;
+    // Of the bundle file, -1 if there is none: a recompiled or removed bundle is opened again
+    qint64 lastModified;
+};
+
+// Opened bundles by directory, null for the directories without a valid one
+static QHash<QString, OpenedBundle> s_bundles;
+
+ThemeBundle::ThemeBundle() = default;
+
+ThemeBundle::~ThemeBundle()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+    }
+}
+
+ThemeBundle::Ptr ThemeBundle::open(const QString &themeDirectory)
+{
+    const QString fileName = themeDirectory + QLatin1Char('/') + QLatin1String(s_fileName);
+    const QFileInfo info(fileName);
+    const qint64 lastModified = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+
+    auto it = s_bundles.constFind(themeDirectory);
+    if (it != s_bundles.constEnd() && it->lastModified == lastModified) {
+        return it->bundle;
+    }
+
+    Ptr bundle;
+    if (lastModified != -1) {
+        bundle = new ThemeBundle;
+        bundle->m_directory = themeDirectory;
+        if (!bundle->load(fileName)) {
+            qCWarning(LOG_KSVG) << "Ignoring invalid or outdated theme bundle" << fileName;
+            bundle = nullptr;
+        }
+    }
+
+    s_bundles.insert(themeDirectory, {bundle, lastModified});
+    return bundle;
+}
+
+ThemeBundle::Ptr ThemeBundle::findFile(const QString &path, uint lastModified, const ImageEntry **image)
+{
+    for (auto it = s_bundles.constBegin(); it != s_bundles.constEnd(); ++it) {
+        const QString &directory = it.key();
+        const Ptr &bundle = it->bundle;
+        if (!bundle || path.size() <= directory.size() || path[directory.size()] != QLatin1Char('/') || !path.startsWith(directory)) {
+            continue;
+        }
+
+        const ImageEntry *entry = bundle->findImage(QStringView(path).mid(directory.size() + 1));
+        if (entry && entry->lastModified == lastModified) {
+            *image = entry;
+            return bundle;
+        }
+        return Ptr();
+    }
+
+    return Ptr();
+}
+
+bool ThemeBundle::load(const QString &fileName)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size < qint64(sizeof(Header))) {
+        return false;
+    }
+
+    m_data = m_file.map(0, m_size);
+    return m_data && validate();
+}
+
+bool ThemeBundle::validate() const
+{
+    const Header *h = header();
+    if (memcmp(h->magic, s_magic, sizeof(s_magic)) != 0 || h->version != s_version || h->byteOrder != s_byteOrder || h->fileSize != quint64(m_size)) {
+        return false;
+    }
+
+    auto fits = [this](quint64 offset, quint64 count, quint64 recordSize) {
+        return offset + count * recordSize <= quint64(m_size);
+    };
+
+    if (!fits(h->stringPoolOffset, h->stringPoolSize, 1) || h->stringPoolOffset % 2 != 0 //
+        || !fits(h->imageTableOffset, h->imageTableCapacity, sizeof(ImageEntry)) || h->imageTableOffset % 8 != 0 //
+        || h->imageTableCapacity == 0 || (h->imageTableCapacity & (h->imageTableCapacity - 1)) != 0) {
+        return false;
+    }
+
+    // Lookups stop at the first empty slot, make sure there always is one
+    quint32 usedSlots = 0;
+    const auto *entries = reinterpret_cast<const ImageEntry *>(m_data + h->imageTableOffset);
+    for (quint32 i = 0; i < h->imageTableCapacity; ++i) {
+        const ImageEntry &entry = entries[i];
+        if (entry.pathLength == 0) {
+            continue;
+        }
+        ++usedSlots;
+        if (quint64(entry.pathOffset) + quint64(entry.pathLength) * 2 > h->stringPoolSize //
+            || !fits(entry.documentOffset, entry.documentLength, 1) //
+            || !fits(entry.stylesOffset, entry.stylesCount, sizeof(StyleRecord)) || entry.stylesOffset % 8 != 0 //
+            || !fits(entry.elementsOffset, entry.elementsCount, sizeof(ElementRecord)) || entry.elementsOffset % 8 != 0) {
+            return false;
+        }
+
+        // The index is applied to the document without further checks
+        const auto *styles = reinterpret_cast<const StyleRecord *>(m_data + entry.stylesOffset);
+        for (quint32 j = 0; j < entry.stylesCount; ++j) {
+            if (styles[j].start > styles[j].end || styles[j].end > entry.documentLength || (j > 0 && styles[j].start < styles[j - 1].end)) {
+                return false;
+            }
+        }
+        const ElementRecord *records = elements(&entry);
+        for (quint32 j = 0; j < entry.elementsCount; ++j) {
+            if (quint64(records[j].idOffset) + records[j].idLength > entry.documentLength || records[j].sizeHintLength > records[j].idLength) {
+                return false;
+            }
+        }
+    }
+
+    return usedSlots < h->imageTableCapacity;
+}
+
+QString ThemeBundle::directory() const
+{
+    return m_directory;
+}
+
+const ThemeBundle::ImageEntry *ThemeBundle::findImage(QStringView relativePath) const
+{
+    if (!m_data || relativePath.isEmpty()) {
+        return nullptr;
+    }
+
+    const Header *h = header();
+    const auto *entries = reinterpret_cast<const ImageEntry *>(m_data + h->imageTableOffset);
+    const quint32 hash = hashPath(relativePath);
+    const quint32 mask = h->imageTableCapacity - 1;
+
+    for (quint32 i = hash & mask;; i = (i + 1) & mask) {
+        const ImageEntry &entry = entries[i];
+        if (entry.pathLength == 0) {
+            return nullptr;
+        }
+        const QStringView path(reinterpret_cast<const QChar *>(m_data + h->stringPoolOffset + entry.pathOffset), entry.pathLength);
+        if (entry.hash == hash && path == relativePath) {
+            return &entry;
+        }
+    }
+}
+
+QByteArray ThemeBundle::document(const ImageEntry *image) const
+{
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(m_data + image->documentOffset), image->documentLength);
+}
+
+SvgDocument::Index ThemeBundle::index(const ImageEntry *image) const
+{
+    SvgDocument::Index index;
+
+    const auto *styles = reinterpret_cast<const StyleRecord *>(m_data + image->stylesOffset);
+    index.colorSchemeStyles.reserve(image->stylesCount);
+    for (quint32 i = 0; i < image->stylesCount; ++i) {
+        index.colorSchemeStyles.append({qsizetype(styles[i].start), qsizetype(styles[i].end), styles[i].selfClosing != 0});
+    }
+
+    // Back in document order
+    const ElementRecord *records = elements(image);
+    index.elementIds.reserve(image->elementsCount);
+    for (quint32 i = 0; i < image->elementsCount; ++i) {
+        index.elementIds.append({qsizetype(records[i].idOffset), qsizetype(records[i].idLength), qsizetype(records[i].sizeHintLength)});
+    }
+    std::sort(index.elementIds.begin(), index.elementIds.end(), [](const SvgDocument::ElementId &a, const SvgDocument::ElementId &b) {
+        return a.start < b.start;
+    });
+
+    return index;
+}
+
+QSizeF ThemeBundle::defaultSize(const ImageEntry *image) const
+{
+    return QSizeF(image->defaultWidth, image->defaultHeight);
+}
+
+const ThemeBundle::ElementRecord *ThemeBundle::elements(const ImageEntry *image) const
+{
+    return reinterpret_cast<const ElementRecord *>(m_data + image->elementsOffset);
+}
+
+bool ThemeBundle::findElementRect(const ImageEntry *image, QStringView elementId, QRectF &rect) const
+{
+    const QByteArray id = elementId.toUtf8();
+    const quint32 hash = hashId(elementId);
+    const ElementRecord *begin = elements(image);
+    const ElementRecord *end = begin + image->elementsCount;
+
+    auto it = std::lower_bound(begin, end, hash, [](const ElementRecord &record, quint32 hash) {
+        return record.idHash < hash;
+    });
+    for (; it != end && it->idHash == hash; ++it) {
+        if (QByteArrayView(m_data + image->documentOffset + it->idOffset, it->idLength) == id) {
+            rect = (it->flags & ElementExists) ? QRectF(it->x, it->y, it->width, it->height) : QRectF();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QHash<QString, QRectF> ThemeBundle::sizeHintedElements(const ImageEntry *image) const
+{
+    QHash<QString, QRectF> elements;
+
+    const ElementRecord *records = this->elements(image);
+    for (quint32 i = 0; i < image->elementsCount; ++i) {
+        const ElementRecord &record = records[i];
+        const QRectF bounds(record.boundsX, record.boundsY, record.boundsWidth, record.boundsHeight);
+        if (record.sizeHintLength > 0 && bounds.isValid()) {
+            elements.insert(QString::fromUtf8(reinterpret_cast<const char *>(m_data + image->documentOffset + record.idOffset), record.idLength), bounds);
+        }
+    }
+
+    return elements;
+}
+
+}
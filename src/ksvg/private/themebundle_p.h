@@ -0,0 +1,168 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KSVG_THEMEBUNDLE_P_H
+#define KSVG_THEMEBUNDLE_P_H
+
+#include <QExplicitlySharedDataPointer>
+#include <QFile>
+#include <QHash>
+#include <QRectF>
+#include <QSharedData>
+#include <QSizeF>
+#include <QString>
+
+#include "autotest_export_p.h"
+#include "stablehash_p.h"
+#include "svg_p.h"
+
+namespace KSvg
+{
+/**
+ * Precompiled content of all the svg files of an image set directory,
+ * produced by ksvg-themecompile.
+ *
+ * The bundle is a single memory mapped file holding, for every svg of the
+ * theme, its decompressed document, the index of its color scheme style and
+ * element ids, the geometry of every element and its default size. Themes
+ * with a bundle are resolved, loaded and measured without locating, reading,
+ * decompressing or parsing any of their files.
+ *
+ * Every image records the modification time of its source file: images
+ * modified after the bundle was compiled are ignored and loaded as usual.
+ */
+class KSVG_AUTOTEST_EXPORT ThemeBundle : public QSharedData
+{
+public:
+    typedef QExplicitlySharedDataPointer<ThemeBundle> Ptr;
+
+    // Bump every time the layout of the file or the way it is hashed changes
+    static constexpr quint32 s_version = 3;
+    static constexpr char s_fileName[] = "theme.ksvgbundle";
+    static constexpr char s_magic[4] = {'K', 'S', 'V', 'B'};
+    static constexpr quint32 s_byteOrder = 0x01020304;
+
+    struct Header {
+        char magic[4];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 imageTableOffset;
+        quint32 imageTableCapacity;
+        quint32 imageCount;
+        quint32 stringPoolOffset;
+        quint32 stringPoolSize;
+        quint64 fileSize;
+    };
+
+    struct ImageEntry {
+        quint32 hash;
+        quint32 pathOffset;
+        quint32 pathLength; // 0 for an unused slot
+        quint32 lastModified;
+        quint32 documentOffset;
+        quint32 documentLength;
+        quint32 stylesOffset;
+        quint32 stylesCount;
+        quint32 elementsOffset;
+        quint32 elementsCount;
+        double defaultWidth;
+        double defaultHeight;
+    };
+
+    struct StyleRecord {
+        quint32 start;
+        quint32 end;
+        quint32 selfClosing;
+        quint32 padding;
+    };
+
+    enum ElementFlag : quint32 {
+        ElementExists = 1,
+    };
+
+    // Sorted by idHash
+    struct ElementRecord {
+        quint32 idHash;
+        quint32 idOffset; // in the document
+        quint32 idLength;
+        quint32 sizeHintLength;
+        quint32 flags;
+        quint32 padding;
+        // Element geometry, as returned by Svg::elementRect() at the default size
+        double x;
+        double y;
+        double width;
+        double height;
+        // Bounds of the element in its own coordinates, as used for size hints
+        double boundsX;
+        double boundsY;
+        double boundsWidth;
+        double boundsHeight;
+    };
+
+    ~ThemeBundle();
+
+    /**
+     * Opens the bundle of the image set in themeDirectory, if any.
+     * Bundles stay opened until their file is compiled again or removed.
+     */
+    static Ptr open(const QString &themeDirectory);
+
+    /**
+     * Finds the image of path among the opened bundles.
+     * @return the bundle containing it, if its content is up to date with lastModified
+     */
+    static Ptr findFile(const QString &path, uint lastModified, const ImageEntry **image);
+
+    // Bundles are compiled by another process than the ones reading them: only use stable hashes
+    static quint32 hashPath(QStringView path)
+    {
+        return stableHash(path);
+    }
+    static quint32 hashId(QStringView id)
+    {
+        return stableHash(id);
+    }
+
+    QString directory() const;
+
+    // relativePath is relative to the image set directory
+    const ImageEntry *findImage(QStringView relativePath) const;
+
+    // The returned data references the mapped file
+    QByteArray document(const ImageEntry *image) const;
+    SvgDocument::Index index(const ImageEntry *image) const;
+    QSizeF defaultSize(const ImageEntry *image) const;
+
+    /**
+     * Rect of elementId at the default size of the image, null if the element
+     * can't be rendered.
+     * @return false if the image has no element with that id
+     */
+    bool findElementRect(const ImageEntry *image, QStringView elementId, QRectF &rect) const;
+
+    QHash<QString, QRectF> sizeHintedElements(const ImageEntry *image) const;
+
+private:
+    ThemeBundle();
+
+    bool load(const QString &fileName);
+    bool validate() const;
+    const Header *header() const
+    {
+        return reinterpret_cast<const Header *>(m_data);
+    }
+    const ElementRecord *elements(const ImageEntry *image) const;
+
+    QString m_directory;
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+};
+
+}
+
+#endif
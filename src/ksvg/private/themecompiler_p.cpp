@@ -0,0 +1,194 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "themecompiler_p.h"
+#include "themebundle_p.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QSvgRenderer>
+
+#include <KCompressionDevice>
+
+#include "themecompiler_debug_p.h"
+
+namespace KSvg
+{
+static quint32 nextPowerOfTwo(quint32 value)
+{
+    quint32 result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+bool compileThemeBundle(const QString &themeDirectory, const QString &fileName, QString *errorString)
+{
+    const QDir directory(themeDirectory);
+    if (!directory.exists()) {
+        if (errorString) {
+            *errorString = QStringLiteral("%1 is not a directory").arg(themeDirectory);
+        }
+        return false;
+    }
+
+    QStringList files;
+    QDirIterator dirIt(themeDirectory, {QStringLiteral("*.svg"), QStringLiteral("*.svgz")}, QDir::Files, QDirIterator::Subdirectories);
+    while (dirIt.hasNext()) {
+        files << directory.relativeFilePath(dirIt.next());
+    }
+    // Same input, same file
+    files.sort();
+
+    QByteArray data(sizeof(ThemeBundle::Header), '\0');
+
+    auto align = [&data](int alignment) {
+        while (data.size() % alignment != 0) {
+            data.append('\0');
+        }
+    };
+
+    QByteArray pool;
+    std::vector<ThemeBundle::ImageEntry> entries;
+    entries.reserve(files.size());
+
+    for (const QString &file : std::as_const(files)) {
+        const QString filePath = directory.filePath(file);
+
+        KCompressionDevice device(filePath, KCompressionDevice::GZip);
+        if (!device.open(QIODevice::ReadOnly)) {
+            qCWarning(LOG_KSVG_THEMECOMPILER) << "Skipping unreadable file" << filePath;
+            continue;
+        }
+        const QByteArray contents = device.readAll();
+
+        // The style sheet only changes colors, the geometry is the same for every renderer
+        QSvgRenderer renderer(contents);
+        if (!renderer.isValid()) {
+            qCWarning(LOG_KSVG_THEMECOMPILER) << "Skipping invalid svg" << filePath;
+            continue;
+        }
+
+        ThemeBundle::ImageEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.hash = ThemeBundle::hashPath(file);
+        entry.pathOffset = pool.size();
+        entry.pathLength = file.size();
+        pool.append(reinterpret_cast<const char *>(file.utf16()), file.size() * 2);
+        entry.lastModified = QFileInfo(filePath).lastModified().toSecsSinceEpoch();
+        entry.defaultWidth = renderer.defaultSize().width();
+        entry.defaultHeight = renderer.defaultSize().height();
+
+        align(8);
+        entry.documentOffset = data.size();
+        entry.documentLength = contents.size();
+        data.append(contents);
+
+        const SvgDocument::Index index = SvgDocument::index(contents);
+
+        align(8);
+        entry.stylesOffset = data.size();
+        entry.stylesCount = index.colorSchemeStyles.size();
+        for (const SvgDocument::StyleRange &style : index.colorSchemeStyles) {
+            const ThemeBundle::StyleRecord record{quint32(style.start), quint32(style.end), style.selfClosing ? 1u : 0u, 0};
+            data.append(reinterpret_cast<const char *>(&record), sizeof(record));
+        }
+
+        std::vector<ThemeBundle::ElementRecord> records;
+        records.reserve(index.elementIds.size());
+        QSet<QByteArrayView> seenIds;
+        for (const SvgDocument::ElementId &elementId : index.elementIds) {
+            const QByteArrayView idBytes(contents.constData() + elementId.start, elementId.length);
+            if (seenIds.contains(idBytes)) {
+                continue;
+            }
+            seenIds.insert(idBytes);
+
+            const QString id = QString::fromUtf8(idBytes);
+            ThemeBundle::ElementRecord record;
+            memset(&record, 0, sizeof(record));
+            record.idHash = ThemeBundle::hashId(id);
+            record.idOffset = elementId.start;
+            record.idLength = elementId.length;
+            record.sizeHintLength = elementId.sizeHintLength;
+
+            const QRectF bounds = renderer.boundsOnElement(id);
+            record.boundsX = bounds.x();
+            record.boundsY = bounds.y();
+            record.boundsWidth = bounds.width();
+            record.boundsHeight = bounds.height();
+
+            if (renderer.elementExists(id)) {
+                const QRectF rect = renderer.transformForElement(id).map(bounds).boundingRect();
+                record.flags = ThemeBundle::ElementExists;
+                record.x = rect.x();
+                record.y = rect.y();
+                record.width = rect.width();
+                record.height = rect.height();
+            }
+            records.push_back(record);
+        }
+        std::stable_sort(records.begin(), records.end(), [](const ThemeBundle::ElementRecord &a, const ThemeBundle::ElementRecord &b) {
+            return a.idHash < b.idHash;
+        });
+
+        align(8);
+        entry.elementsOffset = data.size();
+        entry.elementsCount = records.size();
+        data.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(ThemeBundle::ElementRecord));
+
+        entries.push_back(entry);
+    }
+
+    align(2);
+    ThemeBundle::Header header;
+    memcpy(header.magic, ThemeBundle::s_magic, sizeof(ThemeBundle::s_magic));
+    header.version = ThemeBundle::s_version;
+    header.byteOrder = ThemeBundle::s_byteOrder;
+    header.stringPoolOffset = data.size();
+    header.stringPoolSize = pool.size();
+    data.append(pool);
+
+    // Image table last, now that all the offsets are known
+    align(8);
+    header.imageTableOffset = data.size();
+    header.imageTableCapacity = nextPowerOfTwo(std::max<quint32>(1, entries.size() * 2));
+    header.imageCount = entries.size();
+    std::vector<ThemeBundle::ImageEntry> table(header.imageTableCapacity);
+    memset(table.data(), 0, table.size() * sizeof(ThemeBundle::ImageEntry));
+    const quint32 mask = header.imageTableCapacity - 1;
+    for (const ThemeBundle::ImageEntry &entry : entries) {
+        quint32 i = entry.hash & mask;
+        while (table[i].pathLength != 0) {
+            i = (i + 1) & mask;
+        }
+        table[i] = entry;
+    }
+    data.append(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(ThemeBundle::ImageEntry));
+
+    header.fileSize = data.size();
+    memcpy(data.data(), &header, sizeof(header));
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        if (errorString) {
+            *errorString = QStringLiteral("Could not write %1: %2").arg(fileName, file.errorString());
+        }
+        return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,24 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KSVG_THEMECOMPILER_P_H
+#define KSVG_THEMECOMPILER_P_H
+
+#include <QString>
+
+namespace KSvg
+{
+/**
+ * Compiles all the svg files of the image set in themeDirectory into a bundle
+ * written to fileName. Not part of the library: built into ksvg-themecompile
+ * and the tests from the KF6SvgThemeCompiler object library.
+ *
+ * @return false, with a description of the failure in errorString, if the bundle could not be written
+ */
+bool compileThemeBundle(const QString &themeDirectory, const QString &fileName, QString *errorString = nullptr);
+}
+
+#endif
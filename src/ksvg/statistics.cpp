@@ -0,0 +1,243 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "statistics.h"
+#include "private/statistics_p.h"
+
+#include <atomic>
+
+#include <QtAlgorithms>
+#include <QCoreApplication>
+
+#include "debug_p.h"
+
+namespace KSvg
+{
+namespace
+{
+struct AtomicHistogram {
+    std::atomic<quint64> count;
+    std::atomic<quint64> totalNanoseconds;
+    std::atomic<quint64> maximumNanoseconds;
+    std::atomic<quint64> buckets[Statistics::TimingHistogram::BucketCount];
+};
+
+// Zero initialized, as they have static storage duration
+std::atomic<quint64> s_counters[Statistics::CounterCount];
+std::atomic<qint64> s_gauges[Statistics::GaugeCount];
+AtomicHistogram s_timers[Statistics::TimerCount];
+
+const char *counterName(Statistics::Counter counter)
+{
+    switch (counter) {
+    case Statistics::SvgParses:
+        return "svg parses";
+    case Statistics::SvgRenders:
+        return "svg renders";
+    case Statistics::PixmapCacheHits:
+        return "pixmap cache hits";
+    case Statistics::PixmapCacheMisses:
+        return "pixmap cache misses";
+    case Statistics::PixmapCacheInserts:
+        return "pixmap cache inserts";
+    case Statistics::RectCacheHits:
+        return "rect cache hits";
+    case Statistics::RectCacheMisses:
+        return "rect cache misses";
+    case Statistics::RecentPixmapHits:
+        return "recent pixmap hits";
+    case Statistics::RecentPixmapMisses:
+        return "recent pixmap misses";
+    case Statistics::CounterCount:
+        break;
+    }
+    return "";
+}
+
+const char *gaugeName(Statistics::Gauge gauge)
+{
+    switch (gauge) {
+    case Statistics::Renderers:
+        return "renderers";
+    case Statistics::Documents:
+        return "documents";
+    case Statistics::PixmapCacheBytes:
+        return "pixmap cache bytes";
+    case Statistics::PendingPixmapBytes:
+        return "pending pixmap bytes";
+    case Statistics::FrameSliceBytes:
+        return "frame slice bytes";
+    case Statistics::ResidentRects:
+        return "resident rects";
+    case Statistics::RecentPixmapBytes:
+        return "recent pixmap bytes";
+    case Statistics::GaugeCount:
+        break;
+    }
+    return "";
+}
+
+const char *timerName(Statistics::Timer timer)
+{
+    switch (timer) {
+    case Statistics::ParseTime:
+        return "parse time";
+    case Statistics::RenderTime:
+        return "render time";
+    case Statistics::TimerCount:
+        break;
+    }
+    return "";
+}
+
+void dumpAtExitIfRequested()
+{
+    if (StatisticsPrivate::enabled()) {
+        QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, QCoreApplication::instance(), &Statistics::dump);
+    }
+}
+}
+
+Q_COREAPP_STARTUP_FUNCTION(dumpAtExitIfRequested)
+
+namespace StatisticsPrivate
+{
+void increment(Statistics::Counter counter, quint64 value)
+{
+    s_counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+void setGauge(Statistics::Gauge gauge, qint64 value)
+{
+    s_gauges[gauge].store(value, std::memory_order_relaxed);
+}
+
+void adjustGauge(Statistics::Gauge gauge, qint64 delta)
+{
+    s_gauges[gauge].fetch_add(delta, std::memory_order_relaxed);
+}
+
+bool enabled()
+{
+    static const bool s_enabled = qEnvironmentVariableIsSet("KSVG_STATISTICS");
+    return s_enabled;
+}
+
+void record(Statistics::Timer timer, qint64 nanoseconds)
+{
+    AtomicHistogram &histogram = s_timers[timer];
+    const quint64 duration = quint64(qMax<qint64>(nanoseconds, 0));
+    const quint64 microseconds = duration / 1000;
+    const int bucket = microseconds == 0 ? 0 : qMin(64 - int(qCountLeadingZeroBits(microseconds)), Statistics::TimingHistogram::BucketCount - 1);
+
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.totalNanoseconds.fetch_add(duration, std::memory_order_relaxed);
+    histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    quint64 maximum = histogram.maximumNanoseconds.load(std::memory_order_relaxed);
+    while (duration > maximum && !histogram.maximumNanoseconds.compare_exchange_weak(maximum, duration, std::memory_order_relaxed)) { }
+}
+}
+
+namespace Statistics
+{
+quint64 counter(Counter counter)
+{
+    if (counter < 0 || counter >= CounterCount) {
+        return 0;
+    }
+    return s_counters[counter].load(std::memory_order_relaxed);
+}
+
+qint64 gauge(Gauge gauge)
+{
+    if (gauge < 0 || gauge >= GaugeCount) {
+        return 0;
+    }
+    return s_gauges[gauge].load(std::memory_order_relaxed);
+}
+
+TimingHistogram histogram(Timer timer)
+{
+    TimingHistogram result;
+    if (timer < 0 || timer >= TimerCount) {
+        return result;
+    }
+
+    const AtomicHistogram &histogram = s_timers[timer];
+    result.count = histogram.count.load(std::memory_order_relaxed);
+    result.totalNanoseconds = histogram.totalNanoseconds.load(std::memory_order_relaxed);
+    result.maximumNanoseconds = histogram.maximumNanoseconds.load(std::memory_order_relaxed);
+    for (int i = 0; i < TimingHistogram::BucketCount; ++i) {
+        result.buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+void reset()
+{
+    for (auto &counter : s_counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (auto &histogram : s_timers) {
+        histogram.count.store(0, std::memory_order_relaxed);
+        histogram.totalNanoseconds.store(0, std::memory_order_relaxed);
+        histogram.maximumNanoseconds.store(0, std::memory_order_relaxed);
+        for (auto &bucket : histogram.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void dump()
+{
+    qCInfo(LOG_KSVG) << "KSvg statistics:";
+
+    for (int i = 0; i < CounterCount; ++i) {
+        qCInfo(LOG_KSVG).nospace() << "  " << counterName(Counter(i)) << ": " << counter(Counter(i));
+    }
+
+    const quint64 pixmapLookups = counter(PixmapCacheHits) + counter(PixmapCacheMisses);
+    if (pixmapLookups > 0) {
+        qCInfo(LOG_KSVG).nospace() << "  pixmap cache hit ratio: " << qreal(counter(PixmapCacheHits)) / pixmapLookups;
+    }
+    const quint64 rectLookups = counter(RectCacheHits) + counter(RectCacheMisses);
+    if (rectLookups > 0) {
+        qCInfo(LOG_KSVG).nospace() << "  rect cache hit ratio: " << qreal(counter(RectCacheHits)) / rectLookups;
+    }
+
+    for (int i = 0; i < GaugeCount; ++i) {
+        qCInfo(LOG_KSVG).nospace() << "  " << gaugeName(Gauge(i)) << ": " << gauge(Gauge(i));
+    }
+
+    for (int i = 0; i < TimerCount; ++i) {
+        const TimingHistogram timings = histogram(Timer(i));
+        if (timings.count == 0) {
+            qCInfo(LOG_KSVG).nospace() << "  " << timerName(Timer(i)) << ": none";
+            continue;
+        }
+
+        qCInfo(LOG_KSVG).nospace() << "  " << timerName(Timer(i)) << ": " << timings.count << " samples, total " << timings.totalNanoseconds / 1000
+                                   << "µs, mean " << timings.totalNanoseconds / timings.count / 1000 << "µs, max " << timings.maximumNanoseconds / 1000
+                                   << "µs";
+
+        for (int bucket = 0; bucket < TimingHistogram::BucketCount; ++bucket) {
+            if (timings.buckets[bucket] == 0) {
+                continue;
+            }
+            if (bucket == 0) {
+                qCInfo(LOG_KSVG).nospace() << "    < 1µs: " << timings.buckets[bucket];
+            } else if (bucket == TimingHistogram::BucketCount - 1) {
+                qCInfo(LOG_KSVG).nospace() << "    >= " << (quint64(1) << (bucket - 1)) << "µs: " << timings.buckets[bucket];
+            } else {
+                qCInfo(LOG_KSVG).nospace() << "    < " << (quint64(1) << bucket) << "µs: " << timings.buckets[bucket];
+            }
+        }
+    }
+}
+}
+
+}
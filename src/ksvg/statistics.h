@@ -0,0 +1,111 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KSVG_STATISTICS_H
+#define KSVG_STATISTICS_H
+
+#include <QtGlobal>
+
+#include <array>
+
+#include <ksvg/ksvg_export.h>
+
+namespace KSvg
+{
+/**
+ * @namespace KSvg::Statistics ksvg/statistics.h <KSvg/Statistics>
+ *
+ * @short Runtime statistics of the KSvg caches and renderers
+ *
+ * KSvg keeps process wide counters of how often its caches are hit or missed,
+ * gauges of how much it holds in memory and timing histograms of SVG parsing
+ * and rendering. They are meant to tune ImageSet::setCacheLimit() and to find
+ * out what a given application actually spends its time on.
+ *
+ * All the functions are thread safe. The statistics can be printed with dump(),
+ * which is also done when the application quits if the KSVG_STATISTICS
+ * environment variable is set.
+ *
+ * @since 6.0
+ */
+namespace Statistics
+{
+enum Counter {
+    SvgParses = 0, /**< SVG documents loaded into a renderer */
+    SvgRenders, /**< SVG documents or elements rendered to an image */
+    PixmapCacheHits, /**< Rendered pixmaps found in the pixmap cache */
+    PixmapCacheMisses, /**< Rendered pixmaps not found in the pixmap cache */
+    PixmapCacheInserts, /**< Rendered pixmaps written to the pixmap cache */
+    RectCacheHits, /**< Element geometries found in the rects cache */
+    RectCacheMisses, /**< Element geometries not found in the rects cache */
+    RecentPixmapHits, /**< Pixmap cache hits served by the in process tier of recently used pixmaps */
+    RecentPixmapMisses, /**< Pixmap lookups that had to go past the in process tier */
+    CounterCount,
+};
+
+enum Gauge {
+    Renderers = 0, /**< Live SVG renderers */
+    Documents, /**< SVG files held in memory */
+    PixmapCacheBytes, /**< Bytes used in the shared pixmap caches, only tracked when KSVG_STATISTICS is set */
+    PendingPixmapBytes, /**< Bytes of rendered pixmaps waiting to be written to the pixmap cache */
+    FrameSliceBytes, /**< Bytes of frame corners and tiles kept in memory */
+    ResidentRects, /**< Element rects held in memory by the rects cache */
+    RecentPixmapBytes, /**< Bytes of the recently used pixmaps kept decoded in memory */
+    GaugeCount,
+};
+
+enum Timer {
+    ParseTime = 0, /**< Time spent loading SVG documents into a renderer */
+    RenderTime, /**< Time spent rendering SVG documents or elements */
+    TimerCount,
+};
+
+/**
+ * Distribution of the durations recorded for a Timer.
+ *
+ * Durations are counted in power of two buckets of microseconds: bucket 0
+ * counts durations below 1µs, bucket i durations from 2^(i-1)µs to 2^i µs,
+ * and the last bucket everything longer.
+ */
+struct TimingHistogram {
+    static constexpr int BucketCount = 20;
+
+    quint64 count = 0;
+    quint64 totalNanoseconds = 0;
+    quint64 maximumNanoseconds = 0;
+    std::array<quint64, BucketCount> buckets = {};
+};
+
+/**
+ * @returns the value of @p counter since the start of the process or the last reset()
+ */
+KSVG_EXPORT quint64 counter(Counter counter);
+
+/**
+ * @returns the current value of @p gauge
+ */
+KSVG_EXPORT qint64 gauge(Gauge gauge);
+
+/**
+ * @returns the durations recorded for @p timer since the start of the process or the last reset()
+ */
+KSVG_EXPORT TimingHistogram histogram(Timer timer);
+
+/**
+ * Sets all the counters and timers back to zero.
+ * Gauges describe the current state of the caches and are not affected.
+ */
+KSVG_EXPORT void reset();
+
+/**
+ * Prints all the statistics to the kf.svg logging category, at info level.
+ */
+KSVG_EXPORT void dump();
+}
+
+}
+
+#endif
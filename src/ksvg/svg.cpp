@@ -8,43 +8,36 @@
 #include "svg.h"
 #include "framesvg.h"
 #include "private/imageset_p.h"
+#include "private/stablehash_p.h"
+#include "private/statistics_p.h"
 #include "private/svg_p.h"
+#include "private/themebundle_p.h"
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <memory>
 
-#include <QBuffer>
 #include <QCoreApplication>
+#include <QDataStream>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
 #include <QPainter>
-#include <QRegularExpression>
+#include <QPromise>
+#include <QReadWriteLock>
+#include <QStandardPaths>
 #include <QStringBuilder>
-#include <QXmlStreamReader>
-#include <QXmlStreamWriter>
+#include <QThreadPool>
 
 #include <KCompressionDevice>
-#include <KConfigGroup>
+#include <KDirWatch>
 #include <QDebug>
 
 #include "debug_p.h"
 #include "imageset.h"
 
-uint qHash(const KSvg::SvgPrivate::CacheId &id, uint seed)
-{
-    std::array<size_t, 10> parts = {
-        ::qHash(id.width),
-        ::qHash(id.height),
-        ::qHash(id.elementName),
-        ::qHash(id.filePath),
-        ::qHash(id.status),
-        ::qHash(id.scaleFactor),
-        ::qHash(id.paletteKey),
-        ::qHash(id.extraFlags),
-        ::qHash(id.lastModified),
-    };
-    return qHashRange(parts.begin(), parts.end(), seed);
-}
-
 namespace KSvg
 {
 class SvgRectsCacheSingleton
@@ -55,106 +48,351 @@ public:
 
 Q_GLOBAL_STATIC(SvgRectsCacheSingleton, privateSvgRectsCacheSelf)
 
+// Seed of the fingerprints of cache ids, it only needs to be different from SvgRectsCache::s_seed.
+// The fingerprints are stored in the rects cache file, so they are built from stable hashes only
+static const quint32 s_fingerprintSeed = 0x85ebca6b;
+
+namespace
+{
+struct SvgAtomTable {
+    QReadWriteLock lock;
+    // Atoms by the hash of their string
+    QMultiHash<size_t, const SvgAtom *> atoms;
+};
+
+Q_GLOBAL_STATIC(SvgAtomTable, s_atomTable)
+
+const SvgAtom *findAtom(const SvgAtomTable &table, QStringView string, size_t hash)
+{
+    for (auto it = table.atoms.constFind(hash); it != table.atoms.cend() && it.key() == hash; ++it) {
+        if ((*it)->string == string) {
+            return *it;
+        }
+    }
+    return nullptr;
+}
+}
+
+SvgAtom::SvgAtom(QStringView string, size_t hash)
+    : string(string.toString())
+    , hash(hash)
+    , fingerprint(stableHash(string, s_fingerprintSeed))
+{
+}
+
+const SvgAtom *SvgAtom::intern(QStringView string)
+{
+    SvgAtomTable *table = s_atomTable();
+    const size_t hash = stableHash(string);
+
+    {
+        QReadLocker locker(&table->lock);
+        if (const SvgAtom *atom = findAtom(*table, string, hash)) {
+            return atom;
+        }
+    }
+
+    QWriteLocker locker(&table->lock);
+    if (const SvgAtom *atom = findAtom(*table, string, hash)) {
+        return atom;
+    }
+    const SvgAtom *atom = new SvgAtom(string, hash);
+    table->atoms.insert(hash, atom);
+    return atom;
+}
+
+SvgPrivate::CacheId::CacheId(double width,
+                             double height,
+                             const SvgAtom *filePath,
+                             const SvgAtom *elementName,
+                             int status,
+                             double scaleFactor,
+                             qint64 paletteKey,
+                             uint extraFlags,
+                             uint lastModified)
+    : width(width)
+    , height(height)
+    , filePath(filePath)
+    , elementName(elementName)
+    , status(status)
+    , scaleFactor(scaleFactor)
+    , paletteKey(paletteKey)
+    , extraFlags(extraFlags)
+    , lastModified(lastModified)
+{
+    std::array<size_t, 9> parts = {
+        ::qHash(width),
+        ::qHash(height),
+        elementName->hash,
+        filePath->hash,
+        ::qHash(status),
+        ::qHash(scaleFactor),
+        ::qHash(paletteKey),
+        ::qHash(extraFlags),
+        ::qHash(lastModified),
+    };
+    hash = qHashRange(parts.begin(), parts.end(), SvgRectsCache::s_seed);
+
+    parts[2] = elementName->fingerprint;
+    parts[3] = filePath->fingerprint;
+    fingerprint = qHashRange(parts.begin(), parts.end(), s_fingerprintSeed);
+}
+
+QString SvgPrivate::CacheId::pixmapKey() const
+{
+    // 13 bits per character from U+0100 on: no control characters nor surrogates,
+    // so that the key survives the UTF-8 conversion of KSharedDataCache
+    const quint64 k = key();
+    const std::array<QChar, 5> characters = {
+        QChar(ushort(0x100 + (k & 0x1fff))),
+        QChar(ushort(0x100 + ((k >> 13) & 0x1fff))),
+        QChar(ushort(0x100 + ((k >> 26) & 0x1fff))),
+        QChar(ushort(0x100 + ((k >> 39) & 0x1fff))),
+        QChar(ushort(0x100 + (k >> 52))),
+    };
+    return QString(characters.data(), characters.size());
+}
+
+// Used by Svg::imageAsync()
+Q_GLOBAL_STATIC(QThreadPool, s_renderThreadPool)
+
 const uint SvgRectsCache::s_seed = 0x9e3779b9;
 
+// Each rect takes 56 bytes, in a table at most half full: about 3.5MiB at most
+static const qsizetype s_maxLocalRects = 32768;
+static const qsizetype s_maxSizeHintsForId = 4096;
+// In ms, how long a sync waits for other processes to be done with the rects cache
+static const int s_syncLockTimeout = 2000;
+
+// Search the SVG to find and store all ids that contain size hints.
+static void collectSizeHintedElements(const QByteArray &contents,
+                                      const QList<SvgDocument::ElementId> &elementIds,
+                                      QSvgRenderer *renderer,
+                                      QHash<QString, QRectF> &interestingElements)
+{
+    for (const SvgDocument::ElementId &id : elementIds) {
+        if (id.sizeHintLength == 0) {
+            continue;
+        }
+
+        const QString elementId = QString::fromUtf8(contents.constData() + id.start, id.length);
+        QRectF elementRect = renderer->boundsOnElement(elementId);
+        if (elementRect.isValid()) {
+            interestingElements.insert(elementId, elementRect);
+        }
+    }
+}
+
+SvgDocument::SvgDocument(const QString &path)
+    : m_path(path)
+{
+    reload();
+}
+
+SvgDocument::~SvgDocument() = default;
+
+QString SvgDocument::path() const
+{
+    return m_path;
+}
+
+QByteArray SvgDocument::contents() const
+{
+    return m_contents;
+}
+
+bool SvgDocument::isStyleable() const
+{
+    return !m_index.colorSchemeStyles.isEmpty();
+}
+
+QList<SvgDocument::StyleRange> SvgDocument::colorSchemeStyles() const
+{
+    return m_index.colorSchemeStyles;
+}
+
+QList<SvgDocument::ElementId> SvgDocument::elementIds() const
+{
+    return m_index.elementIds;
+}
+
+QByteArray SvgDocument::applyStyleSheet(const QByteArray &contents, const QList<StyleRange> &styles, const QString &styleSheet)
+{
+    if (styles.isEmpty() || styleSheet.isEmpty()) {
+        return contents;
+    }
+
+    QByteArray css = styleSheet.toUtf8();
+    if (css.contains('&') || css.contains('<') || css.contains('>')) {
+        QByteArray escaped;
+        escaped.reserve(css.size() + 16);
+        for (const char c : std::as_const(css)) {
+            switch (c) {
+            case '&':
+                escaped += "&amp;";
+                break;
+            case '<':
+                escaped += "&lt;";
+                break;
+            case '>':
+                escaped += "&gt;";
+                break;
+            default:
+                escaped += c;
+            }
+        }
+        css = escaped;
+    }
+
+    qsizetype newSize = contents.size();
+    for (const StyleRange &style : styles) {
+        newSize += css.size() - (style.end - style.start) + (style.selfClosing ? 9 : 0);
+    }
+
+    QByteArray processedContents;
+    processedContents.reserve(newSize);
+    qsizetype copied = 0;
+    for (const StyleRange &style : styles) {
+        processedContents.append(contents.constData() + copied, style.start - copied);
+        if (style.selfClosing) {
+            processedContents.append('>');
+            processedContents.append(css);
+            processedContents.append("</style>");
+        } else {
+            processedContents.append(css);
+        }
+        copied = style.end;
+    }
+    processedContents.append(contents.constData() + copied, contents.size() - copied);
+
+    return processedContents;
+}
+
+bool SvgDocument::hasInterestingElements() const
+{
+    return m_interestingElementsCollected;
+}
+
+QHash<QString, QRectF> SvgDocument::interestingElements() const
+{
+    return m_interestingElements;
+}
+
+void SvgDocument::collectInterestingElements(QSvgRenderer *renderer)
+{
+    // The style sheet only changes colors, so the element bounds are the same for every renderer
+    m_interestingElements.clear();
+    collectSizeHintedElements(m_contents, m_index.elementIds, renderer, m_interestingElements);
+    m_interestingElementsCollected = true;
+}
+
+void SvgDocument::reload()
+{
+    m_contents.clear();
+    m_bundle.reset();
+    m_interestingElements.clear();
+    m_interestingElementsCollected = false;
+
+    const ThemeBundle::ImageEntry *image = nullptr;
+    if (const ThemeBundle::Ptr bundle = ThemeBundle::findFile(m_path, QFileInfo(m_path).lastModified().toSecsSinceEpoch(), &image)) {
+        m_bundle = bundle;
+        m_contents = bundle->document(image);
+        m_index = bundle->index(image);
+        m_interestingElements = bundle->sizeHintedElements(image);
+        m_interestingElementsCollected = true;
+        return;
+    }
+
+    KCompressionDevice file(m_path, KCompressionDevice::GZip);
+    if (file.open(QIODevice::ReadOnly)) {
+        m_contents = file.readAll();
+    }
+    m_index = index(m_contents);
+}
+
 SharedSvgRenderer::SharedSvgRenderer(QObject *parent)
     : QSvgRenderer(parent)
 {
 }
 
-SharedSvgRenderer::SharedSvgRenderer(const QString &filename, const QString &styleSheet, QHash<QString, QRectF> &interestingElements, QObject *parent)
+SharedSvgRenderer::SharedSvgRenderer(const SvgDocument::Ptr &document, const QString &styleSheet, QObject *parent)
     : QSvgRenderer(parent)
+    , m_document(document)
+    , m_styleSheet(styleSheet)
 {
-    KCompressionDevice file(filename, KCompressionDevice::GZip);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return;
-    }
-    m_filename = filename;
-    m_styleSheet = styleSheet;
-    m_interestingElements = interestingElements;
-    load(file.readAll(), styleSheet, interestingElements);
+    reload();
 }
 
 SharedSvgRenderer::SharedSvgRenderer(const QByteArray &contents, const QString &styleSheet, QHash<QString, QRectF> &interestingElements, QObject *parent)
     : QSvgRenderer(parent)
 {
-    load(contents, styleSheet, interestingElements);
+    const SvgDocument::Index index = SvgDocument::index(contents);
+    if (load(contents, styleSheet, index.colorSchemeStyles)) {
+        collectSizeHintedElements(contents, index.elementIds, this, interestingElements);
+    }
+}
+
+SvgDocument::Ptr SharedSvgRenderer::document() const
+{
+    return m_document;
+}
+
+QMutex *SharedSvgRenderer::mutex()
+{
+    return &m_mutex;
 }
 
 void SharedSvgRenderer::reload()
 {
-    KCompressionDevice file(m_filename, KCompressionDevice::GZip);
-    if (!file.open(QIODevice::ReadOnly)) {
+    if (!m_document || m_document->contents().isEmpty()) {
         return;
     }
 
-    load(file.readAll(), m_styleSheet, m_interestingElements);
+    QMutexLocker locker(&m_mutex);
+    if (load(m_document->contents(), m_styleSheet, m_document->colorSchemeStyles()) && !m_document->hasInterestingElements()) {
+        m_document->collectInterestingElements(this);
+    }
 }
 
-bool SharedSvgRenderer::load(const QByteArray &contents, const QString &styleSheet, QHash<QString, QRectF> &interestingElements)
+bool SharedSvgRenderer::load(const QByteArray &contents, const QString &styleSheet, const QList<SvgDocument::StyleRange> &styles)
 {
-    // Apply the style sheet.
-    if (!styleSheet.isEmpty() && contents.contains("current-color-scheme")) {
-        QByteArray processedContents;
-        processedContents.reserve(contents.size());
-        QXmlStreamReader reader(contents);
-
-        QBuffer buffer(&processedContents);
-        buffer.open(QIODevice::WriteOnly);
-        QXmlStreamWriter writer(&buffer);
-        while (!reader.atEnd()) {
-            if (reader.readNext() == QXmlStreamReader::StartElement && reader.qualifiedName() == QLatin1String("style")
-                && reader.attributes().value(QLatin1String("id")) == QLatin1String("current-color-scheme")) {
-                writer.writeStartElement(QLatin1String("style"));
-                writer.writeAttributes(reader.attributes());
-                writer.writeCharacters(styleSheet);
-                writer.writeEndElement();
-                while (reader.tokenType() != QXmlStreamReader::EndElement) {
-                    reader.readNext();
-                }
-            } else if (reader.tokenType() != QXmlStreamReader::Invalid) {
-                writer.writeCurrentToken(reader);
-            }
-        }
-        buffer.close();
-        if (!QSvgRenderer::load(processedContents)) {
-            return false;
-        }
-    } else if (!QSvgRenderer::load(contents)) {
-        return false;
-    }
+    StatisticsPrivate::ScopedTimer timer(Statistics::ParseTime);
+    StatisticsPrivate::increment(Statistics::SvgParses);
 
-    // Search the SVG to find and store all ids that contain size hints.
-    const QString contentsAsString(QString::fromLatin1(contents));
-    static const QRegularExpression idExpr(QLatin1String("id\\s*?=\\s*?(['\"])(\\d+?-\\d+?-.*?)\\1"));
-    Q_ASSERT(idExpr.isValid());
+    // Apply the style sheet.
+    return QSvgRenderer::load(SvgDocument::applyStyleSheet(contents, styles, styleSheet));
+}
 
-    auto matchIt = idExpr.globalMatch(contentsAsString);
-    while (matchIt.hasNext()) {
-        auto match = matchIt.next();
-        QString elementId = match.captured(2);
+SvgRectsCache::SvgRectsCache(QObject *parent)
+    : QObject(parent)
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    m_cacheFilePath = cacheDir + QLatin1Char('/') + QStringLiteral("ksvg-elements.bin");
+    m_cacheFile.open(m_cacheFilePath);
+    m_iconThemePath = m_cacheFile.iconThemePath();
 
-        QRectF elementRect = boundsOnElement(elementId);
-        if (elementRect.isValid()) {
-            interestingElements.insert(elementId, elementRect);
-        }
+    // Remove the cache of older versions, which was stored as a text config file
+    const QString legacyCacheFile = cacheDir + QLatin1Char('/') + QStringLiteral("ksvg-elements");
+    if (QFile::exists(legacyCacheFile)) {
+        QFile::remove(legacyCacheFile);
     }
 
-    return true;
+    m_localRectCache.setMaximumSize(s_maxLocalRects);
+
+    m_syncTimer = new QTimer(this);
+    m_syncTimer->setSingleShot(true);
+    m_syncTimer->setInterval(5000);
+    connect(m_syncTimer, &QTimer::timeout, this, &SvgRectsCache::sync);
+
+    KDirWatch *watch = KDirWatch::self();
+    connect(watch, &KDirWatch::dirty, this, &SvgRectsCache::fileChanged);
+    connect(watch, &KDirWatch::created, this, &SvgRectsCache::fileChanged);
+    connect(watch, &KDirWatch::deleted, this, &SvgRectsCache::fileChanged);
 }
 
-SvgRectsCache::SvgRectsCache(QObject *parent)
-    : QObject(parent)
+SvgRectsCache::~SvgRectsCache()
 {
-    const QString svgElementsFile = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QLatin1Char('/') + QStringLiteral("ksvg-elements");
-    m_svgElementsCache = KSharedConfig::openConfig(svgElementsFile, KConfig::SimpleConfig);
-
-    m_configSyncTimer = new QTimer(this);
-    m_configSyncTimer->setSingleShot(true);
-    m_configSyncTimer->setInterval(5000);
-    connect(m_configSyncTimer, &QTimer::timeout, this, [this]() {
-        m_svgElementsCache->sync();
-    });
+    sync();
 }
 
 SvgRectsCache *SvgRectsCache::instance()
@@ -162,58 +400,129 @@ SvgRectsCache *SvgRectsCache::instance()
     return &privateSvgRectsCacheSelf()->self;
 }
 
-void SvgRectsCache::insert(KSvg::SvgPrivate::CacheId cacheId, const QRectF &rect, unsigned int lastModified)
+void SvgRectsCache::scheduleSync()
 {
-    insert(qHash(cacheId, SvgRectsCache::s_seed), cacheId.filePath, rect, lastModified);
+    QMetaObject::invokeMethod(m_syncTimer, qOverload<>(&QTimer::start));
 }
 
-void SvgRectsCache::insert(uint id, const QString &filePath, const QRectF &rect, unsigned int lastModified)
+SvgRectsCacheFile::ImageData &SvgRectsCache::pendingImage(const QString &path)
 {
-    const unsigned int savedTime = lastModifiedTimeFromCache(filePath);
+    auto it = m_pendingImages.find(path);
+    if (it == m_pendingImages.end()) {
+        it = m_pendingImages.insert(path, SvgRectsCacheFile::ImageData());
+        it->lastModified = lastModifiedTimeFromCache(path);
+    }
+    return *it;
+}
 
-    if (savedTime == lastModified && m_localRectCache.contains(id)) {
+void SvgRectsCache::sync()
+{
+    if (m_pendingImages.isEmpty() && m_droppedImages.isEmpty() && !m_iconThemePathChanged) {
         return;
     }
 
-    m_localRectCache.insert(id, rect);
+    // Other processes may have written the file since we mapped it: merge our changes into its latest version.
+    // They sync the same way, so the file must not change between the read and the write
+    QLockFile lock(m_cacheFilePath + QLatin1String(".lock"));
+    if (!lock.tryLock(s_syncLockTimeout)) {
+        qCWarning(LOG_KSVG) << "Could not lock the rects cache" << m_cacheFilePath << lock.error();
+        scheduleSync();
+        return;
+    }
+
+    SvgRectsCacheFile latestFile;
+    latestFile.open(m_cacheFilePath);
+    QHash<QString, SvgRectsCacheFile::ImageData> images = latestFile.images();
+    const QString iconThemePath = m_iconThemePathChanged ? m_iconThemePath : latestFile.iconThemePath();
+    latestFile.close();
 
-    KConfigGroup imageGroup(m_svgElementsCache, filePath);
+    for (const QString &path : std::as_const(m_droppedImages)) {
+        images.remove(path);
+    }
 
-    if (rect.isValid()) {
-        imageGroup.writeEntry(QString::number(id), rect);
+    for (auto it = m_pendingImages.constBegin(); it != m_pendingImages.constEnd(); ++it) {
+        SvgRectsCacheFile::ImageData &image = images[it.key()];
+        if (image.lastModified != it->lastModified) {
+            image = SvgRectsCacheFile::ImageData();
+            image.lastModified = it->lastModified;
+        }
+        image.rects.insert(it->rects);
+        image.naturalSizes.insert(it->naturalSizes);
+        image.sizeHints.insert(it->sizeHints);
+        if (it->hasElementIds) {
+            image.elementIds = it->elementIds;
+            image.hasElementIds = true;
+        }
+    }
+
+    // The mapping must be released before replacing the file, some platforms refuse to do otherwise
+    m_cacheFile.close();
+    if (SvgRectsCacheFile::write(m_cacheFilePath, iconThemePath, images)) {
+        m_pendingImages.clear();
+        m_droppedImages.clear();
+        m_iconThemePathChanged = false;
+    }
+    m_cacheFile.open(m_cacheFilePath);
+}
+
+void SvgRectsCache::insert(const KSvg::SvgPrivate::CacheId &cacheId, const QRectF &rect, unsigned int lastModified)
+{
+    insert(cacheId.key(), cacheId.filePath->string, rect, lastModified);
+}
+
+void SvgRectsCache::insert(quint64 key, const QString &filePath, const QRectF &rect, unsigned int lastModified)
+{
+    const unsigned int savedTime = lastModifiedTimeFromCache(filePath);
+    const SvgAtom *file = SvgAtom::intern(filePath);
+
+    if (savedTime == lastModified) {
+        if (m_localRectCache.contains(key)) {
+            return;
+        }
+        QRectF cachedRect;
+        if (!m_droppedImages.contains(filePath) && m_cacheFile.findElementRect(m_cacheFile.findImage(filePath), key, cachedRect) && cachedRect == rect) {
+            insertLocalRect(key, file, rect);
+            return;
+        }
     } else {
-        m_invalidElements[filePath] << id;
-        imageGroup.writeEntry("Invalidelements", m_invalidElements[filePath].values());
+        // The rects of the previous version of the file can't be looked up anymore
+        m_localRectCache.removeFile(file);
     }
 
-    QMetaObject::invokeMethod(m_configSyncTimer, qOverload<>(&QTimer::start));
+    insertLocalRect(key, file, rect);
 
     if (savedTime != lastModified) {
         m_lastModifiedTimes[filePath] = lastModified;
-        imageGroup.writeEntry("LastModified", lastModified);
+        pendingImage(filePath).lastModified = lastModified;
         Q_EMIT lastModifiedChanged(filePath, lastModified);
     }
+
+    pendingImage(filePath).rects.insert(key, rect.isValid() ? rect : QRectF());
+    scheduleSync();
 }
 
-bool SvgRectsCache::findElementRect(KSvg::SvgPrivate::CacheId cacheId, QRectF &rect)
+void SvgRectsCache::insertLocalRect(quint64 key, const SvgAtom *file, const QRectF &rect)
 {
-    return findElementRect(qHash(cacheId, SvgRectsCache::s_seed), cacheId.filePath, rect);
+    m_localRectCache.insert(key, file, rect);
+    StatisticsPrivate::setGauge(Statistics::ResidentRects, m_localRectCache.size());
 }
 
-bool SvgRectsCache::findElementRect(uint id, QStringView filePath, QRectF &rect)
+bool SvgRectsCache::findElementRect(const KSvg::SvgPrivate::CacheId &cacheId, QRectF &rect)
 {
-    auto it = m_localRectCache.find(id);
+    return findElementRect(cacheId.key(), cacheId.filePath->string, rect);
+}
 
-    if (it == m_localRectCache.end()) {
-        auto elements = m_invalidElements.value(filePath.toString());
-        if (elements.contains(id)) {
-            rect = QRectF();
-            return true;
-        }
-        return false;
+bool SvgRectsCache::findElementRect(quint64 key, QStringView filePath, QRectF &rect)
+{
+    // Invalid elements are found as tombstones, with a null rect
+    if (m_localRectCache.find(key, rect) == SvgRectStore::Missing) {
+        // ids contain the file timestamp, so entries of an outdated file can't match
+        const bool found = m_cacheFile.findElementRect(m_cacheFile.findImage(filePath), key, rect);
+        StatisticsPrivate::increment(found ? Statistics::RectCacheHits : Statistics::RectCacheMisses);
+        return found;
     }
 
-    rect = *it;
+    StatisticsPrivate::increment(Statistics::RectCacheHits);
 
     return true;
 }
@@ -224,59 +533,51 @@ bool SvgRectsCache::loadImageFromCache(const QString &path, uint lastModified)
         return false;
     }
 
-    KConfigGroup imageGroup(m_svgElementsCache, path);
-
     unsigned int savedTime = lastModifiedTimeFromCache(path);
 
     // Reload even if is older, to support downgrades
     if (lastModified != savedTime) {
-        imageGroup.deleteGroup();
-        QMetaObject::invokeMethod(m_configSyncTimer, qOverload<>(&QTimer::start));
+        dropImageFromCache(path);
         return false;
     }
 
-    auto &elements = m_invalidElements[path];
-    if (elements.isEmpty()) {
-        auto list = imageGroup.readEntry("Invalidelements", QList<unsigned int>());
-        m_invalidElements[path] = QSet<unsigned int>(list.begin(), list.end());
-
-        for (const auto &key : imageGroup.keyList()) {
-            bool ok = false;
-            uint keyUInt = key.toUInt(&ok);
-            if (ok) {
-                const QRectF rect = imageGroup.readEntry(key, QRectF());
-                m_localRectCache.insert(keyUInt, rect);
-            }
-        }
-    }
+    // Nothing to load: lookups are done directly in the mapped cache file
     return true;
 }
 
 void SvgRectsCache::dropImageFromCache(const QString &path)
 {
-    KConfigGroup imageGroup(m_svgElementsCache, path);
-    imageGroup.deleteGroup();
-    QMetaObject::invokeMethod(m_configSyncTimer, qOverload<>(&QTimer::start));
+    const SvgAtom *file = SvgAtom::intern(path);
+    m_pendingImages.remove(path);
+    m_elementIdFilters.remove(file);
+    m_localRectCache.removeFile(file);
+    StatisticsPrivate::setGauge(Statistics::ResidentRects, m_localRectCache.size());
+    m_sizeHintsForId.removeIf([&path](const QHash<std::pair<QString, QString>, QList<QSize>>::iterator it) {
+        return it.key().first == path;
+    });
+    if (m_cacheFile.findImage(path)) {
+        m_droppedImages.insert(path);
+    }
+    scheduleSync();
 }
 
 QList<QSize> SvgRectsCache::sizeHintsForId(const QString &path, const QString &id)
 {
-    const QString pathId = path % id;
+    const std::pair<QString, QString> pathId(path, id);
 
     auto it = m_sizeHintsForId.constFind(pathId);
     if (it == m_sizeHintsForId.constEnd()) {
-        KConfigGroup imageGroup(m_svgElementsCache, path);
-        const QStringList &encoded = imageGroup.readEntry(id, QStringList());
         QList<QSize> sizes;
-        for (const auto &token : encoded) {
-            const auto &parts = token.split(QLatin1Char('x'));
-            if (parts.size() != 2) {
-                continue;
-            }
-            QSize size = QSize(parts[0].toDouble(), parts[1].toDouble());
-            if (!size.isEmpty()) {
-                sizes << size;
-            }
+        // The hints not synced yet are only in the pending image once the memo has been cleared
+        auto pendingIt = m_pendingImages.constFind(path);
+        if (pendingIt != m_pendingImages.constEnd() && pendingIt->sizeHints.contains(id)) {
+            sizes = pendingIt->sizeHints.value(id);
+        } else if (!m_droppedImages.contains(path)) {
+            sizes = m_cacheFile.sizeHintsForId(m_cacheFile.findImage(path), id);
+        }
+        // Only a memo of the pending changes and the cache file: start over rather than growing forever
+        if (m_sizeHintsForId.size() >= s_maxSizeHintsForId) {
+            m_sizeHintsForId.clear();
         }
         m_sizeHintsForId[pathId] = sizes;
         return sizes;
@@ -287,69 +588,137 @@ QList<QSize> SvgRectsCache::sizeHintsForId(const QString &path, const QString &i
 
 void SvgRectsCache::insertSizeHintForId(const QString &path, const QString &id, const QSize &size)
 {
-    // TODO: need to make this more efficient
-    auto sizeListToString = [](const QList<QSize> &list) {
-        QString ret;
-        for (const auto &s : list) {
-            ret += QString::number(s.width()) % QLatin1Char('x') % QString::number(s.height()) % QLatin1Char(',');
-        }
-        return ret;
-    };
-    m_sizeHintsForId[path % id].append(size);
-    KConfigGroup imageGroup(m_svgElementsCache, path);
-    imageGroup.writeEntry(id, sizeListToString(m_sizeHintsForId[path % id]));
-    QMetaObject::invokeMethod(m_configSyncTimer, qOverload<>(&QTimer::start));
+    // Make sure the hints already on disk are loaded, as the whole list gets written back
+    QList<QSize> sizes = sizeHintsForId(path, id);
+    if (sizes.contains(size)) {
+        return;
+    }
+
+    sizes.append(size);
+    m_sizeHintsForId[std::pair(path, id)] = sizes;
+    pendingImage(path).sizeHints[id] = sizes;
+    scheduleSync();
 }
 
 QString SvgRectsCache::iconThemePath()
 {
-    if (!m_iconThemePath.isEmpty()) {
-        return m_iconThemePath;
-    }
-
-    KConfigGroup imageGroup(m_svgElementsCache, QStringLiteral("General"));
-    m_iconThemePath = imageGroup.readEntry(QStringLiteral("IconThemePath"), QString());
-
     return m_iconThemePath;
 }
 
 void SvgRectsCache::setIconThemePath(const QString &path)
 {
+    if (m_iconThemePath == path) {
+        return;
+    }
+
     m_iconThemePath = path;
-    KConfigGroup imageGroup(m_svgElementsCache, QStringLiteral("General"));
-    imageGroup.writeEntry(QStringLiteral("IconThemePath"), path);
-    QMetaObject::invokeMethod(m_configSyncTimer, qOverload<>(&QTimer::start));
+    m_iconThemePathChanged = true;
+    scheduleSync();
 }
 
 void SvgRectsCache::setNaturalSize(const QString &path, qreal scaleFactor, const QSizeF &size)
 {
-    KConfigGroup imageGroup(m_svgElementsCache, path);
+    if (naturalSize(path, scaleFactor) == size) {
+        return;
+    }
 
-    // FIXME: needs something faster, perhaps even sprintf
-    imageGroup.writeEntry(QStringLiteral("NaturalSize_") % QString::number(scaleFactor), size);
-    QMetaObject::invokeMethod(m_configSyncTimer, qOverload<>(&QTimer::start));
+    pendingImage(path).naturalSizes.insert(scaleFactor, size);
+    scheduleSync();
 }
 
 QSizeF SvgRectsCache::naturalSize(const QString &path, qreal scaleFactor)
 {
-    KConfigGroup imageGroup(m_svgElementsCache, path);
+    auto it = m_pendingImages.constFind(path);
+    if (it != m_pendingImages.constEnd()) {
+        auto sizeIt = it->naturalSizes.constFind(scaleFactor);
+        if (sizeIt != it->naturalSizes.constEnd()) {
+            return *sizeIt;
+        }
+    }
+
+    if (m_droppedImages.contains(path)) {
+        return QSizeF();
+    }
 
-    // FIXME: needs something faster, perhaps even sprintf
-    return imageGroup.readEntry(QStringLiteral("NaturalSize_") % QString::number(scaleFactor), QSizeF());
+    return m_cacheFile.naturalSize(m_cacheFile.findImage(path), scaleFactor);
 }
 
 QStringList SvgRectsCache::cachedKeysForPath(const QString &path) const
 {
-    KConfigGroup imageGroup(m_svgElementsCache, path);
-    QStringList list = imageGroup.keyList();
-    QStringList filtered;
+    QList<quint64> ids;
+    if (!m_droppedImages.contains(path)) {
+        ids = m_cacheFile.rectKeys(m_cacheFile.findImage(path));
+    }
 
-    std::copy_if(list.begin(), list.end(), std::back_inserter(filtered), [](const QString element) {
-        bool ok;
-        element.toLong(&ok);
-        return ok;
-    });
-    return filtered;
+    auto it = m_pendingImages.constFind(path);
+    if (it != m_pendingImages.constEnd()) {
+        for (auto rectIt = it->rects.constBegin(); rectIt != it->rects.constEnd(); ++rectIt) {
+            if (!ids.contains(rectIt.key())) {
+                ids << rectIt.key();
+            }
+        }
+    }
+
+    QStringList keys;
+    keys.reserve(ids.size());
+    for (quint64 id : std::as_const(ids)) {
+        keys << QString::number(id);
+    }
+    return keys;
+}
+
+SvgRectsCache::ElementIdFilter SvgRectsCache::loadElementIdFilter(const QString &path, unsigned int lastModified)
+{
+    ElementIdFilter filter;
+    filter.lastModified = lastModified;
+
+    if (lastModifiedTimeFromCache(path) != lastModified) {
+        return filter;
+    }
+
+    auto it = m_pendingImages.constFind(path);
+    if (it != m_pendingImages.constEnd() && it->hasElementIds) {
+        filter.known = true;
+        filter.idHashes = it->elementIds;
+    } else if (!m_droppedImages.contains(path)) {
+        filter.known = m_cacheFile.elementIds(m_cacheFile.findImage(path), filter.idHashes);
+    }
+    return filter;
+}
+
+void SvgRectsCache::setElementIds(const QString &path, unsigned int lastModified, const QList<quint32> &idHashes)
+{
+    // Without a timestamp there would be no way to tell when the filter becomes outdated
+    if (path.isEmpty() || lastModified == 0) {
+        return;
+    }
+
+    const SvgAtom *pathAtom = SvgAtom::intern(path);
+    ElementIdFilter filter = loadElementIdFilter(path, lastModified);
+    if (filter.known && filter.idHashes == idHashes) {
+        m_elementIdFilters.insert(pathAtom, filter);
+        return;
+    }
+
+    updateLastModified(path, lastModified);
+    filter.known = true;
+    filter.idHashes = idHashes;
+    m_elementIdFilters.insert(pathAtom, filter);
+
+    SvgRectsCacheFile::ImageData &image = pendingImage(path);
+    image.elementIds = idHashes;
+    image.hasElementIds = true;
+    scheduleSync();
+}
+
+bool SvgRectsCache::mayHaveElement(const SvgAtom *path, unsigned int lastModified, const SvgAtom *elementId)
+{
+    auto it = m_elementIdFilters.find(path);
+    if (it == m_elementIdFilters.end() || it->lastModified != lastModified) {
+        it = m_elementIdFilters.insert(path, loadElementIdFilter(path->string, lastModified));
+    }
+
+    return !it->known || std::binary_search(it->idHashes.cbegin(), it->idHashes.cend(), quint32(elementId->hash));
 }
 
 unsigned int SvgRectsCache::lastModifiedTimeFromCache(const QString &filePath)
@@ -359,25 +728,66 @@ unsigned int SvgRectsCache::lastModifiedTimeFromCache(const QString &filePath)
         return i.value();
     }
 
-    KConfigGroup imageGroup(m_svgElementsCache, filePath);
-    const unsigned int savedTime = imageGroup.readEntry("LastModified", 0);
+    const auto image = m_cacheFile.findImage(filePath);
+    const unsigned int savedTime = image ? image->lastModified : 0;
     m_lastModifiedTimes[filePath] = savedTime;
     return savedTime;
 }
 
 void SvgRectsCache::updateLastModified(const QString &filePath, unsigned int lastModified)
 {
-    KConfigGroup imageGroup(m_svgElementsCache, filePath);
     const unsigned int savedTime = lastModifiedTimeFromCache(filePath);
 
     if (savedTime != lastModified) {
+        m_localRectCache.removeFile(SvgAtom::intern(filePath));
+        StatisticsPrivate::setGauge(Statistics::ResidentRects, m_localRectCache.size());
         m_lastModifiedTimes[filePath] = lastModified;
-        imageGroup.writeEntry("LastModified", lastModified);
-        QMetaObject::invokeMethod(m_configSyncTimer, qOverload<>(&QTimer::start));
+        pendingImage(filePath).lastModified = lastModified;
+        scheduleSync();
         Q_EMIT lastModifiedChanged(filePath, lastModified);
     }
 }
 
+void SvgRectsCache::watchFile(const QString &path)
+{
+    if (m_watchedFiles[path]++ == 0) {
+        KDirWatch::self()->addFile(path);
+    }
+}
+
+void SvgRectsCache::unwatchFile(const QString &path)
+{
+    auto it = m_watchedFiles.find(path);
+    if (it == m_watchedFiles.end() || --(*it) > 0) {
+        return;
+    }
+
+    m_watchedFiles.erase(it);
+    if (KDirWatch::exists()) {
+        KDirWatch::self()->removeFile(path);
+    }
+}
+
+void SvgRectsCache::fileChanged(const QString &path)
+{
+    // The watcher is shared with the rest of the application
+    if (!m_watchedFiles.contains(path)) {
+        return;
+    }
+
+    const QFileInfo info(path);
+    const unsigned int lastModified = info.exists() ? info.lastModified().toSecsSinceEpoch() : 0;
+    if (lastModified == lastModifiedTimeFromCache(path)) {
+        return;
+    }
+
+    // The renderers, rects and pixmaps of the other files are still good. The pixmaps of
+    // this one are keyed by its modification time, so they won't be found anymore
+    SvgPrivate::reloadFile(path);
+    dropImageFromCache(path);
+    updateLastModified(path, lastModified);
+}
+
 SvgPrivate::SvgPrivate(Svg *svg)
     : q(svg)
     , renderer(nullptr)
@@ -397,6 +807,10 @@ SvgPrivate::SvgPrivate(Svg *svg)
 SvgPrivate::~SvgPrivate()
 {
     eraseRenderer();
+    // Svgs can outlive the cache when they are deleted on exit
+    if (!watchedPath.isEmpty() && !privateSvgRectsCacheSelf.isDestroyed()) {
+        SvgRectsCache::instance()->unwatchFile(watchedPath);
+    }
 }
 
 quint64 SvgPrivate::paletteId(const QPalette &palette, const QColor &positive, const QColor &neutral, const QColor &negative) const
@@ -413,23 +827,49 @@ quint64 SvgPrivate::paletteId(const QPalette &palette, const QColor &positive, c
 // This function is meant for the rects cache
 SvgPrivate::CacheId SvgPrivate::cacheId(QStringView elementId) const
 {
-    auto idSize = size.isValid() && size != naturalSize ? size : QSizeF{-1.0, -1.0};
-    return CacheId{idSize.width(), idSize.height(), path, elementId.toString(), status, scaleFactor, -1, 0, lastModified};
+    return cacheId(SvgAtom::intern(elementId));
+}
+
+SvgPrivate::CacheId SvgPrivate::cacheId(const SvgAtom *elementId) const
+{
+    // Rects are cached at the natural size only, see scaledToSize()
+    return CacheId(-1.0, -1.0, pathAtom(), elementId, status, scaleFactor, -1, 0, lastModified);
+}
+
+QRectF SvgPrivate::scaledToSize(const QRectF &rect) const
+{
+    if (!rect.isValid() || size.isEmpty() || naturalSize.isEmpty() || size == naturalSize) {
+        return rect;
+    }
+
+    const qreal dx = size.width() / naturalSize.width();
+    const qreal dy = size.height() / naturalSize.height();
+    return QRectF(rect.x() * dx, rect.y() * dy, rect.width() * dx, rect.height() * dy);
 }
 
 // This function is meant for the pixmap cache
 QString SvgPrivate::cachePath(const QString &id, const QSize &size) const
 {
-    auto cacheId = CacheId{double(size.width()),
-                           double(size.height()),
-                           path,
-                           id,
-                           status,
-                           scaleFactor,
-                           paletteId(q->palette(), q->extraColor(Svg::Positive), q->extraColor(Svg::Neutral), q->extraColor(Svg::Negative)),
-                           0,
-                           lastModified};
-    return QString::number(qHash(cacheId, SvgRectsCache::s_seed));
+    const CacheId cacheId(double(size.width()),
+                          double(size.height()),
+                          pathAtom(),
+                          SvgAtom::intern(id),
+                          status,
+                          scaleFactor,
+                          paletteId(q->palette(), q->extraColor(Svg::Positive), q->extraColor(Svg::Neutral), q->extraColor(Svg::Negative)),
+                          0,
+                          lastModified);
+    return cacheId.pixmapKey();
+}
+
+const SvgAtom *SvgPrivate::pathAtom() const
+{
+    // Comparing with the string the atom was made from is cheap when it's still path itself
+    if (!m_pathAtom || m_atomPath != path) {
+        m_atomPath = path;
+        m_pathAtom = SvgAtom::intern(path);
+    }
+    return m_pathAtom;
 }
 
 bool SvgPrivate::setImagePath(const QString &imagePath)
@@ -485,6 +925,16 @@ bool SvgPrivate::setImagePath(const QString &imagePath)
 #endif
     }
 
+    if (watchedPath != path) {
+        if (!watchedPath.isEmpty()) {
+            SvgRectsCache::instance()->unwatchFile(watchedPath);
+        }
+        watchedPath = path;
+        if (!watchedPath.isEmpty()) {
+            SvgRectsCache::instance()->watchFile(watchedPath);
+        }
+    }
+
     QDateTime lastModifiedDate;
     if (!path.isEmpty()) {
         const QFileInfo info(path);
@@ -495,25 +945,14 @@ bool SvgPrivate::setImagePath(const QString &imagePath)
         const bool imageWasCached = SvgRectsCache::instance()->loadImageFromCache(path, lastModified);
 
         if (!imageWasCached) {
-            auto i = s_renderers.constBegin();
-            while (i != s_renderers.constEnd()) {
-                if (i.key().contains(path)) {
-                    i.value()->reload();
-                }
-                i++;
-            }
+            reloadFile(path);
         }
     }
 
     // also images with absolute path needs to have a natural size initialized,
     // even if looks a bit weird using ImageSet to store non-themed stuff
     if ((themed && !path.isEmpty() && lastModifiedDate.isValid()) || QFileInfo::exists(actualPath)) {
-        naturalSize = SvgRectsCache::instance()->naturalSize(path, scaleFactor);
-        if (naturalSize.isEmpty()) {
-            createRenderer();
-            naturalSize = renderer->defaultSize() * scaleFactor;
-            SvgRectsCache::instance()->setNaturalSize(path, scaleFactor, naturalSize);
-        }
+        loadNaturalSize();
     }
 
     q->resize();
@@ -522,6 +961,60 @@ bool SvgPrivate::setImagePath(const QString &imagePath)
     return updateNeeded;
 }
 
+void SvgPrivate::loadNaturalSize()
+{
+    naturalSize = SvgRectsCache::instance()->naturalSize(path, scaleFactor);
+    if (naturalSize.isEmpty()) {
+        const ThemeBundle::ImageEntry *image = nullptr;
+        if (const ThemeBundle::Ptr bundle = ThemeBundle::findFile(path, lastModified, &image)) {
+            // What creating the renderer would have cached, without parsing the file
+            naturalSize = bundle->defaultSize(image) * scaleFactor;
+            cacheInterestingElements(bundle->sizeHintedElements(image));
+        } else {
+            createRenderer();
+            QMutexLocker locker(renderer->mutex());
+            naturalSize = renderer->defaultSize() * scaleFactor;
+        }
+        SvgRectsCache::instance()->setNaturalSize(path, scaleFactor, naturalSize);
+    }
+}
+
+void SvgPrivate::fileChanged()
+{
+    // The renderer has already been reloaded, but what creating it cached is gone with the old content
+    if (renderer && renderer->document()) {
+        const SvgDocument::Ptr document = renderer->document();
+        cacheInterestingElements(document->interestingElements());
+
+        QMutexLocker locker(renderer->mutex());
+        QList<quint32> idHashes;
+        if (renderer->isValid() && document->elementIdHashes(idHashes)) {
+            SvgRectsCache::instance()->setElementIds(path, lastModified, idHashes);
+        }
+    }
+
+    if (QFileInfo::exists(path)) {
+        loadNaturalSize();
+    }
+}
+
+void SvgPrivate::reloadFile(const QString &path)
+{
+    // Read the file again only once, all the renderers then parse the new content
+    auto document = s_documents.value(path);
+    if (document) {
+        document->reload();
+    }
+    auto i = s_renderers.constBegin();
+    while (i != s_renderers.constEnd()) {
+        // Keys are the style sheet checksum followed by the path
+        if (QStringView(i.key()).mid(1) == path) {
+            i.value()->reload();
+        }
+        i++;
+    }
+}
+
 ImageSet *SvgPrivate::actualImageSet()
 {
     if (!theme) {
@@ -546,11 +1039,8 @@ ImageSet *SvgPrivate::cacheAndColorsImageSet()
     }
 }
 
-QPixmap SvgPrivate::findInCache(const QString &elementId, const QSizeF &s)
+QSize SvgPrivate::resolveElement(const QString &elementId, const QSizeF &s, QString &actualElementId)
 {
-    QSize size;
-    QString actualElementId;
-
     // Look at the size hinted elements and try to find the smallest one with an
     // identical aspect ratio.
     if (s.isValid() && !elementId.isEmpty()) {
@@ -577,10 +1067,16 @@ QPixmap SvgPrivate::findInCache(const QString &elementId, const QSizeF &s)
     }
 
     if (elementId.isEmpty() || (multipleImages && s.isValid())) {
-        size = s.toSize();
+        return s.toSize();
     } else {
-        size = elementRect(actualElementId).size().toSize();
+        return elementRect(actualElementId).size().toSize();
     }
+}
+
+QPixmap SvgPrivate::findInCache(const QString &elementId, const QSizeF &s)
+{
+    QString actualElementId;
+    const QSize size = resolveElement(elementId, s, actualElementId);
 
     if (size.isEmpty()) {
         return QPixmap();
@@ -595,9 +1091,14 @@ QPixmap SvgPrivate::findInCache(const QString &elementId, const QSizeF &s)
         return p;
     }
 
-    createRenderer();
+    // Without a renderer yet, replaying the display list of the element spares parsing the file
+    const bool useDisplayList = cacheRendering && useDisplayLists();
+    DisplayList displayList;
+    const bool replay = useDisplayList && !renderer && findDisplayList(actualElementId, displayList);
 
-    QRectF finalRect = makeUniform(renderer->boundsOnElement(actualElementId), QRect(QPoint(0, 0), size));
+    if (!replay) {
+        createRenderer();
+    }
 
     // don't alter the pixmap size or it won't match up properly to, e.g., FrameSvg elements
     // makeUniform should never change the size so much that it gains or loses a whole pixel
@@ -606,14 +1107,29 @@ QPixmap SvgPrivate::findInCache(const QString &elementId, const QSizeF &s)
     p.fill(Qt::transparent);
     QPainter renderPainter(&p);
 
-    if (actualElementId.isEmpty()) {
-        renderer->render(&renderPainter, finalRect);
+    if (replay) {
+        StatisticsPrivate::ScopedTimer timer(Statistics::RenderTime);
+        StatisticsPrivate::increment(Statistics::SvgRenders);
+        playDisplayList(&renderPainter, displayList, size);
     } else {
-        renderer->render(&renderPainter, actualElementId, finalRect);
+        QMutexLocker locker(renderer->mutex());
+        StatisticsPrivate::ScopedTimer timer(Statistics::RenderTime);
+        StatisticsPrivate::increment(Statistics::SvgRenders);
+        QRectF finalRect = makeUniform(renderer->boundsOnElement(actualElementId), QRect(QPoint(0, 0), size));
+
+        if (actualElementId.isEmpty()) {
+            renderer->render(&renderPainter, finalRect);
+        } else {
+            renderer->render(&renderPainter, actualElementId, finalRect);
+        }
     }
 
     renderPainter.end();
 
+    if (useDisplayList && !replay) {
+        recordDisplayList(actualElementId);
+    }
+
     if (cacheRendering) {
         cacheAndColorsImageSet()->d->insertIntoCache(id, p, QString::number((qint64)q, 16) % QLatin1Char('_') % actualElementId);
     }
@@ -623,6 +1139,101 @@ QPixmap SvgPrivate::findInCache(const QString &elementId, const QSizeF &s)
     return p;
 }
 
+QFuture<QImage> SvgPrivate::findInCacheAsync(const QString &elementId, const QSizeF &s)
+{
+    QString actualElementId;
+    const QSize size = resolveElement(elementId, s, actualElementId);
+
+    if (size.isEmpty()) {
+        return QtFuture::makeReadyFuture(QImage());
+    }
+
+    const QString id = cachePath(actualElementId, size);
+
+    QPixmap p;
+    if (cacheRendering && lastModified == SvgRectsCache::instance()->lastModifiedTimeFromCache(path)
+        && cacheAndColorsImageSet()->d->findInCache(id, p, lastModified)) {
+        return QtFuture::makeReadyFuture(p.toImage());
+    }
+
+    // Replaying a display list is cheap enough to be done right away
+    DisplayList displayList;
+    if (cacheRendering && useDisplayLists() && !renderer && findDisplayList(actualElementId, displayList)) {
+        QImage image(size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter renderPainter(&image);
+        {
+            StatisticsPrivate::ScopedTimer timer(Statistics::RenderTime);
+            StatisticsPrivate::increment(Statistics::SvgRenders);
+            playDisplayList(&renderPainter, displayList, size);
+        }
+        renderPainter.end();
+
+        cacheAndColorsImageSet()->d->insertIntoCache(id, QPixmap::fromImage(image), QString::number((qint64)q, 16) % QLatin1Char('_') % actualElementId);
+        SvgRectsCache::instance()->updateLastModified(path, lastModified);
+        return QtFuture::makeReadyFuture(image);
+    }
+
+    // Creating the renderer touches the shared caches, so it's done here: only the rendering itself runs in the pool
+    createRenderer();
+
+    auto promise = std::make_shared<QPromise<QImage>>();
+    QFuture<QImage> future = promise->future();
+    promise->start();
+
+    QPointer<ImageSet> imageSet = cacheRendering ? cacheAndColorsImageSet() : nullptr;
+    const QString cacheKey = QString::number((qint64)q, 16) % QLatin1Char('_') % actualElementId;
+    const QString filePath = path;
+    const unsigned int fileLastModified = lastModified;
+    // Changes if the file is modified while rendering, in which case the image is outdated
+    const unsigned int cachedLastModified = SvgRectsCache::instance()->lastModifiedTimeFromCache(path);
+
+    s_renderThreadPool()->start([promise, size, actualElementId, id, imageSet, cacheKey, filePath, fileLastModified, cachedLastModified, jobRenderer = renderer]() mutable {
+        QImage image(size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter renderPainter(&image);
+
+        {
+            QMutexLocker locker(jobRenderer->mutex());
+            StatisticsPrivate::ScopedTimer timer(Statistics::RenderTime);
+            StatisticsPrivate::increment(Statistics::SvgRenders);
+            QRectF finalRect = makeUniform(jobRenderer->boundsOnElement(actualElementId), QRect(QPoint(0, 0), size));
+
+            if (actualElementId.isEmpty()) {
+                jobRenderer->render(&renderPainter, finalRect);
+            } else {
+                jobRenderer->render(&renderPainter, actualElementId, finalRect);
+            }
+        }
+
+        renderPainter.end();
+
+        promise->addResult(image);
+        promise->finish();
+
+        // The caches and the renderer, which is a QObject, belong to the main thread
+        QCoreApplication *app = QCoreApplication::instance();
+        if (!app) {
+            return;
+        }
+        QMetaObject::invokeMethod(
+            app,
+            [image, id, imageSet, cacheKey, filePath, fileLastModified, cachedLastModified, jobRenderer = std::move(jobRenderer)]() mutable {
+                // Setting the time back would undo the invalidation of the file
+                if (SvgRectsCache::instance()->lastModifiedTimeFromCache(filePath) == cachedLastModified) {
+                    if (imageSet) {
+                        imageSet->d->insertIntoCache(id, QPixmap::fromImage(image), cacheKey);
+                    }
+                    SvgRectsCache::instance()->updateLastModified(filePath, fileLastModified);
+                }
+                SvgPrivate::releaseJobRenderer(jobRenderer);
+            },
+            Qt::QueuedConnection);
+    });
+
+    return future;
+}
+
 void SvgPrivate::createRenderer()
 {
     if (renderer) {
@@ -639,60 +1250,117 @@ void SvgPrivate::createRenderer()
         }
     }
 
-    QString styleSheet = cacheAndColorsImageSet()->d->svgStyleSheet(q->palette(),
-                                                                    q->extraColor(Svg::Positive),
-                                                                    q->extraColor(Svg::Neutral),
-                                                                    q->extraColor(Svg::Negative),
-                                                                    status);
-    styleCrc = qChecksum(QByteArrayView(styleSheet.toUtf8().constData(), styleSheet.size()));
+    SvgDocument::Ptr document;
+    if (!path.isEmpty()) {
+        document = s_documents.value(path);
+        if (!document) {
+            document = new SvgDocument(path);
+            s_documents[path] = document;
+            StatisticsPrivate::setGauge(Statistics::Documents, s_documents.size());
+        }
+    }
+
+    // Documents without a color scheme look the same whatever the colors: share a single renderer
+    QString styleSheet;
+    if (document && document->isStyleable()) {
+        styleSheet = cacheAndColorsImageSet()->d->svgStyleSheet(q->palette(),
+                                                                q->extraColor(Svg::Positive),
+                                                                q->extraColor(Svg::Neutral),
+                                                                q->extraColor(Svg::Negative),
+                                                                status);
+        styleCrc = qChecksum(QByteArrayView(styleSheet.toUtf8().constData(), styleSheet.size()));
+    } else {
+        styleCrc = QChar(0);
+    }
 
-    QHash<QString, SharedSvgRenderer::Ptr>::const_iterator it = s_renderers.constFind(styleCrc + path);
+    const QString key = styleCrc + path;
+    QHash<QString, SharedSvgRenderer::Ptr>::const_iterator it = s_renderers.constFind(key);
 
     if (it != s_renderers.constEnd()) {
         renderer = it.value();
     } else {
-        if (path.isEmpty()) {
+        if (!document) {
             renderer = new SharedSvgRenderer();
         } else {
-            QHash<QString, QRectF> interestingElements;
-            renderer = new SharedSvgRenderer(path, styleSheet, interestingElements);
-
-            // Add interesting elements to the theme's rect cache.
-            QHashIterator<QString, QRectF> i(interestingElements);
-
-            QRegularExpression sizeHintedKeyExpr(QStringLiteral("^(\\d+)-(\\d+)-(.+)$"));
-
-            while (i.hasNext()) {
-                i.next();
-                const QString &elementId = i.key();
-                QString originalId = i.key();
-                const QRectF &elementRect = i.value();
+            renderer = new SharedSvgRenderer(document, styleSheet);
+            cacheInterestingElements(document->interestingElements());
 
-                originalId.replace(sizeHintedKeyExpr, QStringLiteral("\\3"));
-                SvgRectsCache::instance()->insertSizeHintForId(path, originalId, elementRect.size().toSize());
-
-                const CacheId cacheId({-1.0, -1.0, path, elementId, status, scaleFactor, -1, 0, lastModified});
-                SvgRectsCache::instance()->insert(cacheId, elementRect, lastModified);
+            QList<quint32> idHashes;
+            if (renderer->isValid() && document->elementIdHashes(idHashes)) {
+                SvgRectsCache::instance()->setElementIds(path, lastModified, idHashes);
             }
         }
 
-        s_renderers[styleCrc + path] = renderer;
+        s_renderers[key] = renderer;
+        StatisticsPrivate::setGauge(Statistics::Renderers, s_renderers.size());
     }
 
     if (size == QSizeF()) {
+        QMutexLocker locker(renderer->mutex());
         size = renderer->defaultSize();
     }
 }
 
+void SvgPrivate::cacheInterestingElements(const QHash<QString, QRectF> &interestingElements)
+{
+    // Add interesting elements to the theme's rect cache.
+    QHashIterator<QString, QRectF> i(interestingElements);
+
+    while (i.hasNext()) {
+        i.next();
+        const QString &elementId = i.key();
+        const QString originalId = elementId.mid(SvgDocument::sizeHintLength(QStringView(elementId)));
+        const QRectF &elementRect = i.value();
+
+        SvgRectsCache::instance()->insertSizeHintForId(path, originalId, elementRect.size().toSize());
+
+        // Rects are cached at the natural size
+        const CacheId cacheId = SvgPrivate::cacheId(SvgAtom::intern(elementId));
+        SvgRectsCache::instance()->insert(cacheId, QRectF(elementRect.topLeft() * scaleFactor, elementRect.size() * scaleFactor), lastModified);
+    }
+}
+
 void SvgPrivate::eraseRenderer()
 {
+    SvgDocument::Ptr document = renderer ? renderer->document() : SvgDocument::Ptr();
+
     if (renderer && renderer->ref.loadRelaxed() == 2) {
         // this and the cache reference it
         s_renderers.erase(s_renderers.find(styleCrc + path));
+        StatisticsPrivate::setGauge(Statistics::Renderers, s_renderers.size());
     }
 
     renderer = nullptr;
     styleCrc = QChar(0);
+
+    if (document && document->ref.loadRelaxed() == 2) {
+        // no renderer uses it anymore, only this and the cache reference it
+        s_documents.remove(document->path());
+        StatisticsPrivate::setGauge(Statistics::Documents, s_documents.size());
+    }
+}
+
+void SvgPrivate::releaseJobRenderer(SharedSvgRenderer::Ptr &renderer)
+{
+    SvgDocument::Ptr document = renderer->document();
+
+    if (renderer->ref.loadRelaxed() == 2) {
+        // The Svgs which used it have been through eraseRenderer() while the job held it: only this and the cache reference it
+        for (auto it = s_renderers.begin(); it != s_renderers.end(); ++it) {
+            if (it.value() == renderer) {
+                s_renderers.erase(it);
+                StatisticsPrivate::setGauge(Statistics::Renderers, s_renderers.size());
+                break;
+            }
+        }
+    }
+
+    renderer = nullptr;
+
+    if (document && document->ref.loadRelaxed() == 2) {
+        s_documents.remove(document->path());
+        StatisticsPrivate::setGauge(Statistics::Documents, s_documents.size());
+    }
 }
 
 QRectF SvgPrivate::elementRect(QStringView elementId)
@@ -714,15 +1382,26 @@ QRectF SvgPrivate::elementRect(QStringView elementId)
         return QRectF();
     }
 
+    // Ids the file doesn't have are answered without computing any rect, nor creating a renderer
+    const SvgAtom *elementAtom = SvgAtom::intern(elementId);
+    if (!SvgRectsCache::instance()->mayHaveElement(pathAtom(), lastModified, elementAtom)) {
+        return QRectF();
+    }
+
+    // Cached rects can't be scaled without knowing the natural size
+    if (naturalSize.isEmpty()) {
+        naturalSize = SvgRectsCache::instance()->naturalSize(path, scaleFactor);
+    }
+
     QRectF rect;
-    const CacheId cacheId = SvgPrivate::cacheId(elementId);
-    bool found = SvgRectsCache::instance()->findElementRect(cacheId, rect);
+    const CacheId cacheId = SvgPrivate::cacheId(elementAtom);
+    bool found = !naturalSize.isEmpty() && SvgRectsCache::instance()->findElementRect(cacheId, rect);
     // This is a corner case where we are *sure* the element is not valid
     if (!found) {
-        rect = findAndCacheElementRect(elementId);
+        return findAndCacheElementRect(elementId);
     }
 
-    return rect;
+    return scaledToSize(rect);
 }
 
 QRectF SvgPrivate::findAndCacheElementRect(QStringView elementId)
@@ -730,9 +1409,28 @@ QRectF SvgPrivate::findAndCacheElementRect(QStringView elementId)
     // we need to check the id before createRenderer(), otherwise it may generate a different id compared to the previous cacheId)( call
     const CacheId cacheId = SvgPrivate::cacheId(elementId);
 
+    const ThemeBundle::ImageEntry *image = nullptr;
+    if (!renderer) {
+        if (const ThemeBundle::Ptr bundle = ThemeBundle::findFile(path, lastModified, &image)) {
+            const QSizeF defaultSize = bundle->defaultSize(image);
+            if (size == QSizeF()) {
+                size = defaultSize;
+            }
+            naturalSize = defaultSize * scaleFactor;
+
+            QRectF elementRect;
+            bundle->findElementRect(image, elementId, elementRect);
+            elementRect = QRectF(elementRect.topLeft() * scaleFactor, elementRect.size() * scaleFactor);
+
+            SvgRectsCache::instance()->insert(cacheId, elementRect, lastModified);
+            return scaledToSize(elementRect);
+        }
+    }
+
     createRenderer();
 
     auto elementIdString = elementId.toString();
+    QMutexLocker locker(renderer->mutex());
 
     // This code will usually never be run because createRenderer already caches all the boundingRect in the elements in the svg
     QRectF elementRect = renderer->elementExists(elementIdString)
@@ -740,14 +1438,13 @@ QRectF SvgPrivate::findAndCacheElementRect(QStringView elementId)
         : QRectF();
 
     naturalSize = renderer->defaultSize() * scaleFactor;
+    locker.unlock();
 
-    qreal dx = size.width() / renderer->defaultSize().width();
-    qreal dy = size.height() / renderer->defaultSize().height();
-
-    elementRect = QRectF(elementRect.x() * dx, elementRect.y() * dy, elementRect.width() * dx, elementRect.height() * dy);
+    // Stored at the natural size, whatever the current size is
+    elementRect = QRectF(elementRect.topLeft() * scaleFactor, elementRect.size() * scaleFactor);
     SvgRectsCache::instance()->insert(cacheId, elementRect, lastModified);
 
-    return elementRect;
+    return scaledToSize(elementRect);
 }
 
 bool Svg::eventFilter(QObject *watched, QEvent *event)
@@ -771,6 +1468,82 @@ qreal SvgPrivate::closestDistance(qreal to, qreal from)
     }
 }
 
+bool SvgPrivate::useDisplayLists()
+{
+    static const bool enabled = qEnvironmentVariableIntValue("KSVG_DISPLAY_LISTS") > 0;
+    return enabled;
+}
+
+QString SvgPrivate::displayListKey(const QString &elementId) const
+{
+    // Display lists don't depend on the size, but they do on the colors
+    return QLatin1String("dl_") + cachePath(elementId, QSize());
+}
+
+bool SvgPrivate::findDisplayList(const QString &elementId, DisplayList &displayList)
+{
+    QByteArray data;
+    if (!cacheAndColorsImageSet()->d->findDisplayList(displayListKey(elementId), data, lastModified)) {
+        return false;
+    }
+
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_6_0);
+    QByteArray pictureData;
+    stream >> displayList.bounds >> displayList.recordedRect >> pictureData;
+    if (stream.status() != QDataStream::Ok || displayList.recordedRect.isEmpty() || pictureData.isEmpty()) {
+        return false;
+    }
+
+    displayList.picture.setData(pictureData.constData(), pictureData.size());
+    return !displayList.picture.isNull();
+}
+
+void SvgPrivate::recordDisplayList(const QString &elementId)
+{
+    ImageSetPrivate *imageSet = cacheAndColorsImageSet()->d;
+    const QString key = displayListKey(elementId);
+    if (imageSet->hasDisplayList(key)) {
+        return;
+    }
+
+    DisplayList displayList;
+    {
+        QMutexLocker locker(renderer->mutex());
+        displayList.bounds = renderer->boundsOnElement(elementId);
+        const QSizeF recordedSize = elementId.isEmpty() || displayList.bounds.isEmpty() ? QSizeF(renderer->defaultSize()) : displayList.bounds.size();
+        displayList.recordedRect = QRectF(QPointF(0, 0), recordedSize);
+        if (displayList.recordedRect.isEmpty()) {
+            return;
+        }
+
+        QPainter painter(&displayList.picture);
+        if (elementId.isEmpty()) {
+            renderer->render(&painter, displayList.recordedRect);
+        } else {
+            renderer->render(&painter, elementId, displayList.recordedRect);
+        }
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << displayList.bounds << displayList.recordedRect << QByteArray::fromRawData(displayList.picture.data(), displayList.picture.size());
+    imageSet->insertDisplayList(key, data);
+}
+
+void SvgPrivate::playDisplayList(QPainter *painter, const DisplayList &displayList, const QSize &size)
+{
+    // Same geometry as rendering the element with the renderer
+    const QRectF finalRect = makeUniform(displayList.bounds, QRect(QPoint(0, 0), size));
+
+    painter->save();
+    painter->translate(finalRect.topLeft());
+    painter->scale(finalRect.width() / displayList.recordedRect.width(), finalRect.height() / displayList.recordedRect.height());
+    painter->drawPicture(QPointF(0, 0), displayList.picture);
+    painter->restore();
+}
+
 QRectF SvgPrivate::makeUniform(const QRectF &orig, const QRectF &dst)
 {
     if (qFuzzyIsNull(orig.x()) || qFuzzyIsNull(orig.y())) {
@@ -829,6 +1602,7 @@ void SvgPrivate::colorsChanged()
 }
 
 QHash<QString, SharedSvgRenderer::Ptr> SvgPrivate::s_renderers;
+QHash<QString, SvgDocument::Ptr> SvgPrivate::s_documents;
 QPointer<ImageSet> SvgPrivate::s_systemColorsCache;
 qreal SvgPrivate::s_lastScaleFactor = 1.0;
 
@@ -837,8 +1611,10 @@ Svg::Svg(QObject *parent)
     , d(new SvgPrivate(this))
 {
     connect(SvgRectsCache::instance(), &SvgRectsCache::lastModifiedChanged, this, [this](const QString &filePath, unsigned int lastModified) {
+        // Only the svgs of that file are concerned
         if (d->lastModified != lastModified && filePath == d->path) {
             d->lastModified = lastModified;
+            d->fileChanged();
             Q_EMIT repaintNeeded();
         }
     });
@@ -899,6 +1675,7 @@ void Svg::setScaleFactor(qreal ratio)
     d->naturalSize = SvgRectsCache::instance()->naturalSize(d->path, d->scaleFactor);
     if (d->naturalSize.isEmpty()) {
         d->createRenderer();
+        QMutexLocker locker(d->renderer->mutex());
         d->naturalSize = d->renderer->defaultSize() * d->scaleFactor;
     }
 
@@ -928,6 +1705,11 @@ QImage Svg::image(const QSize &size, const QString &elementID)
     return pix.toImage();
 }
 
+QFuture<QImage> Svg::imageAsync(const QSize &size, const QString &elementID)
+{
+    return d->findInCacheAsync(elementID, size);
+}
+
 void Svg::paint(QPainter *painter, const QPointF &point, const QString &elementID)
 {
     Q_ASSERT(painter->device());
@@ -1044,6 +1826,7 @@ bool Svg::isValid() const
         return false;
     }
     d->createRenderer();
+    QMutexLocker locker(d->renderer->mutex());
     return d->renderer->isValid();
 }
 
@@ -7,6 +7,8 @@
 #ifndef KSVG_SVG_H
 #define KSVG_SVG_H
 
+#include <QFuture>
+#include <QImage>
 #include <QObject>
 #include <QPixmap>
 
@@ -129,6 +131,21 @@ public:
      */
     Q_INVOKABLE QImage image(const QSize &size, const QString &elementID = QString());
 
+    /**
+     * Asynchronous version of image().
+     *
+     * The pixmap cache is looked up immediately and a ready future is
+     * returned when the image was found there; otherwise the SVG is rendered
+     * in a thread pool, and the result is added to the cache once available.
+     *
+     * @param size  the size of the image
+     * @param elementId  the ID string of the element to render, or an empty
+     *                 string for the whole SVG (the default)
+     * @return a future for the rendered image
+     * @since 6.0
+     */
+    QFuture<QImage> imageAsync(const QSize &size, const QString &elementID = QString());
+
     /**
      * Paints all or part of the SVG represented by this object
      *
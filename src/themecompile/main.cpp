@@ -0,0 +1,57 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KSvg Authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QGuiApplication>
+
+#include <ksvg/private/themecompiler_p.h>
+
+#include "ksvg_version.h"
+
+#include <iostream>
+
+int main(int argc, char **argv)
+{
+    // Measuring the elements needs fonts, but no display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QGuiApplication app(argc, argv);
+    app.setApplicationName(QStringLiteral("ksvg-themecompile"));
+    app.setApplicationVersion(QStringLiteral(PLASMA_VERSION_STRING));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        QStringLiteral("Compiles all the svg files of an image set into a single bundle, loaded instead of the individual files.\n"
+                       "The bundle has to be compiled again every time the image set is modified: modified files are loaded from disk "
+                       "and files added later are ignored."));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument(QStringLiteral("directory"), QStringLiteral("Directory of the image set, for instance /usr/share/plasma/desktoptheme/default"));
+    QCommandLineOption outputOption({QStringLiteral("o"), QStringLiteral("output")},
+                                    QStringLiteral("Write the bundle to <file> instead of the image set directory."),
+                                    QStringLiteral("file"));
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+
+    const QString directory = QDir::cleanPath(QFileInfo(parser.positionalArguments().constFirst()).absoluteFilePath());
+    const QString output = parser.isSet(outputOption) ? parser.value(outputOption) : directory + QLatin1String("/theme.ksvgbundle");
+
+    QString errorString;
+    if (!KSvg::compileThemeBundle(directory, output, &errorString)) {
+        std::cerr << qPrintable(errorString) << std::endl;
+        return 1;
+    }
+
+    return 0;
+}